@@ -0,0 +1,127 @@
+// Autotune test on a simulated drivetrain
+//
+// The drivetrain is modelled as a first order motor with dead time: its speed approaches the commanded power times a
+// gain with a time constant, and commands take effect after a delay. The position is the integral of the speed. The
+// relay experiment and the step response are run on it the same way Chassis::autotune runs them on a robot, with a
+// 10ms update period. The measured ultimate gain and period are compared against the ones calculated from the model,
+// and the step response of the gains from each tuning rule is checked for overshoot and settling
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <deque>
+#include "lemlib/autotune.hpp"
+#include "lemlib/pid.hpp"
+
+namespace {
+constexpr float DT = 0.01; // seconds per update
+constexpr int SUBSTEPS = 10; // simulation steps per update
+constexpr float GAIN = 60.0 / 127; // steady state speed per unit of power, in inches per second
+constexpr float TIME_CONSTANT = 0.2; // seconds
+constexpr float DEAD_TIME = 0.03; // seconds
+constexpr float SMALL_ERROR = 1; // inches
+constexpr float STEP_SIZE = 24; // inches
+
+class Plant {
+    public:
+        Plant()
+            : delay(int(std::round(DEAD_TIME / DT * SUBSTEPS)), 0.0f) {}
+
+        // hold a command for one update, and return the position at the end of it
+        float update(float power) {
+            for (int i = 0; i < SUBSTEPS; i++) {
+                delay.push_back(power);
+                const float applied = delay.front();
+                delay.pop_front();
+                const float h = DT / SUBSTEPS;
+                const float prevSpeed = speed;
+                speed += (GAIN * applied - speed) * (1 - std::exp(-h / TIME_CONSTANT));
+                position += (prevSpeed + speed) / 2 * h;
+            }
+            return position;
+        }
+
+        float position = 0;
+    private:
+        float speed = 0;
+        std::deque<float> delay;
+};
+
+// ultimate gain and period of the model. The command is held between updates, which adds half an update of delay
+void analytic(float& ku, float& tu) {
+    const float deadTime = DEAD_TIME + DT / 2;
+    // the phase of the plant reaches -180 degrees where atan(w * T) + w * L = pi / 2
+    float low = 0;
+    float high = M_PI / 2 / deadTime;
+    for (int i = 0; i < 50; i++) {
+        const float w = (low + high) / 2;
+        if (std::atan(w * TIME_CONSTANT) + w * deadTime < M_PI / 2) low = w;
+        else high = w;
+    }
+    const float w = (low + high) / 2;
+    ku = w * std::sqrt(1 + w * w * TIME_CONSTANT * TIME_CONSTANT) / GAIN;
+    tu = 2 * M_PI / w;
+}
+
+lemlib::AutotuneResult relay(const lemlib::AutotuneParams& params) {
+    Plant plant;
+    lemlib::RelayExperiment relay(params);
+    float x = 0;
+    for (int i = 0; i < 3000 && !relay.isDone(); i++) x = plant.update(relay.update(x, i * DT));
+    return relay.getResult();
+}
+
+void step(lemlib::AutotuneResult& result) {
+    Plant plant;
+    lemlib::PID pid(result.kP, result.kI, result.kD, 0, true);
+    lemlib::StepResponse response(STEP_SIZE, STEP_SIZE, SMALL_ERROR, 0);
+    float x = 0;
+    for (int i = 0; i < 500; i++) {
+        response.update(x, i * DT);
+        x = plant.update(std::clamp(pid.update(STEP_SIZE - x, DT, x), -127.0f, 127.0f));
+    }
+    result.overshoot = response.getOvershoot();
+    result.settlingTime = response.getSettlingTime() * 1000;
+}
+} // namespace
+
+int main() {
+    bool pass = true;
+    float ku;
+    float tu;
+    analytic(ku, tu);
+    std::printf("first order motor, gain %.3f in/s per power, time constant %gs, dead time %gs\n", GAIN,
+                TIME_CONSTANT, DEAD_TIME);
+    std::printf("%-26s %8s %8s %8s %8s %10s\n", "", "Ku", "error", "Tu (s)", "error", "amplitude");
+    std::printf("%-26s %8.2f %8s %8.3f %8s\n", "model", ku, "", tu, "");
+    for (const auto& [output, hysteresis] :
+         {std::pair {40.0f, 0.05f}, std::pair {40.0f, 0.1f}, std::pair {127.0f, 0.5f}, std::pair {40.0f, 0.5f}}) {
+        const lemlib::AutotuneResult result = relay({.relayOutput = output, .hysteresis = hysteresis});
+        const float kuError = (result.ku - ku) / ku;
+        const float tuError = (result.tu - tu) / tu;
+        char name[48];
+        std::snprintf(name, sizeof(name), "relay %g, %g\" hysteresis", output, hysteresis);
+        std::printf("%-26s %8.2f %7.1f%% %8.3f %7.1f%% %10.2f\n", name, result.ku, kuError * 100, result.tu,
+                    tuError * 100, result.amplitude);
+        // the relay only approximates the ultimate gain, so a rough match is expected. Large hysteresis delays the
+        // switching and underestimates it further, which is why the default is small. Those rows are only reported
+        if (!result.success) pass = false;
+        if (hysteresis <= 0.1f && (std::fabs(kuError) > 0.3 || std::fabs(tuError) > 0.3)) pass = false;
+    }
+
+    std::printf("\n%d\" step, default relay\n", int(STEP_SIZE));
+    std::printf("%-16s %8s %8s %8s %10s %14s\n", "rule", "kP", "kI", "kD", "overshoot", "settling (ms)");
+    for (const auto& [name, rule] : {std::pair {"ZIEGLER_NICHOLS", lemlib::TuningRule::ZIEGLER_NICHOLS},
+                                     std::pair {"SOME_OVERSHOOT", lemlib::TuningRule::SOME_OVERSHOOT},
+                                     std::pair {"NO_OVERSHOOT", lemlib::TuningRule::NO_OVERSHOOT},
+                                     std::pair {"TYREUS_LUYBEN", lemlib::TuningRule::TYREUS_LUYBEN}}) {
+        lemlib::AutotuneResult result = relay({.rule = rule});
+        step(result);
+        std::printf("%-16s %8.2f %8.3f %8.2f %9.1f%% %14.0f\n", name, result.kP, result.kI, result.kD,
+                    result.overshoot * 100, result.settlingTime);
+        // every rule has to settle, and the no overshoot rule can't overshoot past the small error range
+        if (!result.success || result.settlingTime >= 4000) pass = false;
+        if (rule == lemlib::TuningRule::NO_OVERSHOOT && result.overshoot * STEP_SIZE > SMALL_ERROR) pass = false;
+    }
+    if (!pass) std::printf("FAILED\n");
+    return !pass;
+}
@@ -0,0 +1,87 @@
+// Model predictive controller benchmark
+//
+// Tracks a reference driving around a circle, starting off the path, with a simple unicycle simulation of the robot.
+// At the faster speed the outer wheel is near the maximum wheel velocity, so the bounds of the quadratic program are
+// active. The solver normally stops early once it converges, so the tolerance is set to 0 to force every sweep, which
+// is the worst case. Each update is timed several times from the same state and the fastest run is kept, so being
+// preempted by the host doesn't count, but the slowest update still does. The worst update has to fit the budget
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+#include "lemlib/mpc.hpp"
+
+namespace {
+constexpr float DT = 0.01; // seconds per update
+constexpr float TRACK_WIDTH = 10; // inches
+constexpr float MAX_VELOCITY = 60; // maximum wheel velocity, in inches per second
+constexpr float RADIUS = 30; // radius of the reference, in inches
+constexpr int UPDATES = 1000;
+constexpr int REPEATS = 5; // times each update is timed
+// longest an update can take on the host. If a V5 brain is around 15 times slower, which is an estimate, this is
+// under a quarter of the 10ms motion loop
+constexpr double BUDGET_US = 150;
+
+struct Result {
+        double meanUs = 0;
+        double worstUs = 0;
+        float finalError = 0; // distance from the reference at the end, in inches
+};
+
+Result run(const lemlib::MPCSettings& settings, float velocity) {
+    Result result;
+    lemlib::MPC mpc(TRACK_WIDTH, settings);
+    std::vector<lemlib::MPCReference> trajectory(settings.horizon, {velocity, 1 / RADIUS});
+    lemlib::Pose robot(3, -2, 0.2);
+    lemlib::Pose reference(0, 0, 0);
+    std::vector<double> times;
+    for (int i = 0; i < UPDATES; i++) {
+        // the reference curves to the right, starting at the origin facing up
+        const float angle = velocity * i * DT / RADIUS;
+        reference = lemlib::Pose(RADIUS - RADIUS * std::cos(angle), RADIUS * std::sin(angle), angle);
+        // every repeat starts from the same warm start
+        lemlib::MPC solved = mpc;
+        lemlib::MPCOutput output;
+        double fastest = INFINITY;
+        for (int repeat = 0; repeat < REPEATS; repeat++) {
+            solved = mpc;
+            const auto start = std::chrono::steady_clock::now();
+            output = solved.update(robot, reference, trajectory, MAX_VELOCITY);
+            const auto end = std::chrono::steady_clock::now();
+            fastest = std::min(fastest, std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        mpc = solved;
+        times.push_back(fastest);
+        // heading is clockwise, so the left wheel going faster turns right
+        const float linear = (output.left + output.right) / 2;
+        const float angular = (output.left - output.right) / TRACK_WIDTH;
+        robot.x += linear * std::sin(robot.theta) * DT;
+        robot.y += linear * std::cos(robot.theta) * DT;
+        robot.theta += angular * DT;
+    }
+    for (const double us : times) result.meanUs += us / UPDATES;
+    result.worstUs = *std::max_element(times.begin(), times.end());
+    result.finalError = robot.distance(reference);
+    return result;
+}
+} // namespace
+
+int main() {
+    bool pass = true;
+    std::printf("model predictive controller, %d updates tracking a %g\" radius circle, every sweep forced\n",
+                UPDATES, RADIUS);
+    std::printf("%-8s %-11s %-15s %10s %11s %12s\n", "horizon", "iterations", "speed (in/s)", "mean (us)",
+                "worst (us)", "error (in)");
+    for (const int horizon : {10, 20}) {
+        for (const float velocity : {30.0f, 50.0f}) {
+            const Result result = run({.horizon = horizon, .iterations = 20, .tolerance = 0}, velocity);
+            std::printf("%-8d %-11d %-15g %10.1f %11.1f %12.3f\n", horizon, 20, velocity, result.meanUs,
+                        result.worstUs, result.finalError);
+            if (result.worstUs > BUDGET_US) pass = false;
+        }
+    }
+    std::printf("budget: %gus\n", BUDGET_US);
+    if (!pass) std::printf("FAILED\n");
+    return !pass;
+}
@@ -0,0 +1,128 @@
+// Odometry integration benchmark
+//
+// Drives a simulated robot along a trajectory with continuously changing speed and curvature. The ground truth is
+// integrated in long double with fine substeps, and the tracking wheel readings are quantized to the resolution of a
+// rotation sensor on a 2" wheel. Both integration methods are fed the same readings at 100Hz, and compared after a 2
+// minute match and after 30 minutes of driving against:
+// - the ground truth. This includes the error of assuming the robot moves in an arc between updates
+// - the same readings integrated in long double. This is only the rounding error of the integration
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "lemlib/chassis/odom.hpp"
+
+// integration steps, defined in odom.cpp
+void integrateArc(float deltaX, float deltaY, float deltaHeading, float horizontalOffset, float verticalOffset);
+void integrateExact(double deltaX, double deltaY, double deltaHeading, double horizontalOffset, double verticalOffset);
+
+namespace {
+constexpr double DT = 0.01; // seconds per odometry update
+constexpr int SUBSTEPS = 100; // ground truth substeps per update
+constexpr double VERTICAL_OFFSET = 1.5; // inches
+constexpr double HORIZONTAL_OFFSET = -2.25; // inches
+constexpr double RESOLUTION = 2 * M_PI / 36000; // inches per rotation sensor tick on a 2" wheel
+
+// forward speed, in inches per second, and clockwise angular speed, in radians per second
+double speed(double t) { return 45 + 25 * std::sin(0.13 * t); }
+
+double angularSpeed(double t) { return 2.2 * std::sin(0.41 * t) + 0.6 * std::sin(1.7 * t); }
+
+struct Truth {
+        long double x = 0;
+        long double y = 0;
+        long double theta = 0;
+        long double vertical = 0; // distance traveled by the vertical wheel
+        long double horizontal = 0; // distance traveled by the horizontal wheel
+};
+
+// advance the ground truth by one odometry update with midpoint substeps
+void step(Truth& truth, double t) {
+    const long double h = DT / SUBSTEPS;
+    for (int i = 0; i < SUBSTEPS; i++) {
+        const long double mid = t + (i + 0.5L) * h;
+        const long double v = speed(mid);
+        const long double w = angularSpeed(mid);
+        const long double heading = truth.theta + w * h / 2;
+        truth.x += v * h * std::sin(heading);
+        truth.y += v * h * std::cos(heading);
+        truth.theta += w * h;
+        // wheels that aren't at the tracking center also move when the robot turns
+        truth.vertical += (v - VERTICAL_OFFSET * w) * h;
+        truth.horizontal += -HORIZONTAL_OFFSET * w * h;
+    }
+}
+
+double quantize(long double distance) { return std::round(double(distance) / RESOLUTION) * RESOLUTION; }
+
+// long double integration of the same readings, which only differs from the tested methods by rounding
+struct Reference {
+        long double x = 0;
+        long double y = 0;
+        long double theta = 0;
+
+        void integrate(long double deltaX, long double deltaY, long double deltaHeading) {
+            const long double centerX = deltaX + HORIZONTAL_OFFSET * deltaHeading;
+            const long double centerY = deltaY + VERTICAL_OFFSET * deltaHeading;
+            const long double half = deltaHeading / 2;
+            const long double scale = half == 0 ? 1 : std::sin(half) / half;
+            const long double heading = theta + half;
+            x += scale * (centerY * std::sin(heading) - centerX * std::cos(heading));
+            y += scale * (centerY * std::cos(heading) + centerX * std::sin(heading));
+            theta += deltaHeading;
+        }
+};
+
+struct Result {
+        double truthError[2] = {0, 0};
+        double roundingError[2] = {0, 0};
+        double nsPerUpdate = 0;
+};
+
+template <typename Integrate> Result run(Integrate integrate) {
+    Result result;
+    lemlib::setPose({0, 0, 0}, true);
+    Truth truth;
+    Reference reference;
+    double vertical = 0;
+    double horizontal = 0;
+    double elapsed = 0; // time spent integrating, in nanoseconds
+    const int updates = 30 * 60 / DT;
+    for (int i = 0; i < updates; i++) {
+        const double prevTheta = truth.theta;
+        step(truth, i * DT);
+        const double newVertical = quantize(truth.vertical);
+        const double newHorizontal = quantize(truth.horizontal);
+        const double deltaHeading = double(truth.theta) - prevTheta;
+        reference.integrate(newHorizontal - horizontal, newVertical - vertical, deltaHeading);
+        const auto start = std::chrono::steady_clock::now();
+        integrate(newHorizontal - horizontal, newVertical - vertical, deltaHeading);
+        elapsed += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        vertical = newVertical;
+        horizontal = newHorizontal;
+        if (i == int(120 / DT) - 1 || i == updates - 1) {
+            const lemlib::Pose pose = lemlib::getPose(true);
+            const int index = i == updates - 1;
+            result.truthError[index] = std::hypot(pose.x - double(truth.x), pose.y - double(truth.y));
+            result.roundingError[index] = std::hypot(pose.x - double(reference.x), pose.y - double(reference.y));
+        }
+    }
+    result.nsPerUpdate = elapsed / updates;
+    return result;
+}
+} // namespace
+
+int main() {
+    const Result arc = run([](double dx, double dy, double dTheta) {
+        integrateArc(dx, dy, dTheta, HORIZONTAL_OFFSET, VERTICAL_OFFSET);
+    });
+    const Result exact = run([](double dx, double dy, double dTheta) {
+        integrateExact(dx, dy, dTheta, HORIZONTAL_OFFSET, VERTICAL_OFFSET);
+    });
+    std::printf("odometry integration, %gHz updates\n", 1 / DT);
+    std::printf("%-6s %10s %26s %26s\n", "", "", "error vs ground truth (in)", "rounding error (in)");
+    std::printf("%-6s %10s %13s %12s %13s %12s\n", "method", "ns/update", "2min", "30min", "2min", "30min");
+    for (const auto& [name, result] : {std::pair {"ARC", arc}, std::pair {"EXACT", exact}}) {
+        std::printf("%-6s %10.1f %13.2e %12.2e %13.2e %12.2e\n", name, result.nsPerUpdate, result.truthError[0],
+                    result.truthError[1], result.roundingError[0], result.roundingError[1]);
+    }
+}
@@ -0,0 +1,99 @@
+// Path planner benchmark
+//
+// Times PathPlanner::plan on a 144" x 144" field at 1" resolution, with no time budget, so the timings can be used to
+// choose one. Each plan includes growing the obstacles by the radius of the robot. The cases are:
+// - random fields, with small obstacles and long barriers, planned from one corner to the opposite one
+// - a long detour: the goal is behind a barrier that spans almost the whole field
+// - an unreachable goal in a small pocket, which the planner rules out before searching
+// - an unreachable goal on the other side of a wall across the field. Both sides are too big to rule out, so every
+//   cell the robot can reach has to be searched. This is the worst case
+// - a start against a wall, inside the grown wall, which has to be able to drive away from it
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "lemlib/planner.hpp"
+#include "lemlib/logger/logger.hpp"
+
+namespace {
+constexpr int RANDOM_FIELDS = 200;
+
+struct Timing {
+        double meanUs = 0;
+        double worstUs = 0;
+        int found = 0;
+        int runs = 0;
+};
+
+lemlib::PlannerSettings unlimited() { return {.robotRadius = 9, .timeBudget = 1000000}; }
+
+void time(Timing& timing, const lemlib::OccupancyGrid& grid, float x, float y, lemlib::Waypoint goal) {
+    lemlib::PathPlanner planner(unlimited());
+    const auto start = std::chrono::steady_clock::now();
+    planner.plan(grid, x, y, goal);
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    timing.meanUs += (us - timing.meanUs) / ++timing.runs;
+    timing.worstUs = std::max(timing.worstUs, us);
+    if (planner.getStatus() == lemlib::PlanStatus::FOUND) timing.found++;
+}
+
+void print(const char* name, const Timing& timing) {
+    std::printf("%-22s %6d %6d %10.0f %11.0f\n", name, timing.runs, timing.found, timing.meanUs, timing.worstUs);
+}
+} // namespace
+
+int main() {
+    bool pass = true;
+    // the warnings about goals that can't be reached would be mixed into the table
+    lemlib::infoSink()->setLowestLevel(lemlib::Level::FATAL);
+    std::printf("path planner, 144\" x 144\" field at 1\" resolution, 9\" robot radius\n");
+    std::printf("%-22s %6s %6s %10s %11s\n", "case", "plans", "found", "mean (us)", "worst (us)");
+
+    Timing random;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-60, 60);
+    for (int i = 0; i < RANDOM_FIELDS; i++) {
+        lemlib::OccupancyGrid grid;
+        for (int j = 0; j < 8; j++) grid.addCircle(position(rng), position(rng), 4);
+        for (int j = 0; j < 3; j++) {
+            const float x = position(rng);
+            const float y = position(rng);
+            grid.addRectangle(x, y, x + (j % 2 ? 30 : 2), y + (j % 2 ? 2 : 30));
+        }
+        time(random, grid, -60, -60, {60, 60});
+    }
+    print("random", random);
+
+    Timing detour;
+    lemlib::OccupancyGrid barrier;
+    barrier.addRectangle(-72, -1, 48, 1);
+    for (int i = 0; i < 10; i++) time(detour, barrier, 0, -36, {0, 36});
+    print("detour", detour);
+    if (detour.found != detour.runs) pass = false;
+
+    Timing unreachable;
+    lemlib::OccupancyGrid enclosed;
+    enclosed.addRectangle(40, 40, 70, 41);
+    enclosed.addRectangle(40, 40, 41, 70);
+    for (int i = 0; i < 10; i++) time(unreachable, enclosed, -60, -60, {65, 65});
+    print("unreachable, pocket", unreachable);
+    if (unreachable.found != 0) pass = false;
+
+    Timing split;
+    lemlib::OccupancyGrid halves;
+    halves.addRectangle(-72, -1, 72, 1);
+    for (int i = 0; i < 10; i++) time(split, halves, 0, -36, {0, 36});
+    print("unreachable, wall", split);
+    if (split.found != 0) pass = false;
+
+    Timing wall;
+    lemlib::OccupancyGrid field;
+    field.addRectangle(-72, -72, 72, -70);
+    for (const float y : {-55.0f, -62.0f, -65.0f}) time(wall, field, 0, y, {0, 40});
+    print("start against a wall", wall);
+    if (wall.found != wall.runs) pass = false;
+
+    if (!pass) std::printf("FAILED\n");
+    return !pass;
+}
@@ -0,0 +1,116 @@
+// Motion profile check
+//
+// Plans jerk limited profiles and samples them every millisecond. The jerk is estimated from how much the
+// acceleration changes between samples, and has to stay within the limit everywhere, including where the profile
+// stops accelerating and starts decelerating. The velocity has to stay within its limit once the robot has had time
+// to slow down to it, the acceleration within its limit, and the position can't jump, including to the distance at
+// the end. The cases are
+// short moves that never reach the maximum velocity, long ones that do, ones that slow down partway, and ones that
+// start moving forwards too fast or moving backwards
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+#include "lemlib/motionProfile.hpp"
+
+namespace {
+constexpr float MAX_ACCELERATION = 120; // inches per second squared
+constexpr float SAMPLE_TIME = 0.001; // seconds
+constexpr float TOLERANCE = 0.02; // fraction of each limit the samples can go over
+constexpr float JUMP_TOLERANCE = 0.01; // inches
+
+struct Case {
+        const char* name;
+        float distance;
+        std::vector<float> maxVelocities;
+        float startVelocity = 0;
+        float endVelocity = 0;
+};
+
+struct Result {
+        float duration = 0;
+        float maxJerk = 0;
+        float maxAcceleration = 0;
+        float overLimit = 0; // most the velocity goes over the limit by, once it could have slowed down
+        float jump = 0; // most the position moves between samples by more than the velocity explains
+        float endVelocity = 0;
+        double planUs = 0;
+};
+
+// the velocity limit at a position, interpolated the same way the profile does
+float limitAt(const Case& test, float position) {
+    const float fraction = std::clamp(position / test.distance, 0.0f, 1.0f);
+    const float index = fraction * (test.maxVelocities.size() - 1);
+    const std::size_t lower = std::min(std::size_t(index), test.maxVelocities.size() - 1);
+    const std::size_t upper = std::min(lower + 1, test.maxVelocities.size() - 1);
+    const float t = index - lower;
+    return test.maxVelocities[lower] * (1 - t) + test.maxVelocities[upper] * t;
+}
+
+Result run(const Case& test, float maxJerk) {
+    Result result;
+    const auto start = std::chrono::steady_clock::now();
+    const lemlib::MotionProfile profile(test.distance, test.maxVelocities, MAX_ACCELERATION, maxJerk,
+                                        test.startVelocity, test.endVelocity);
+    result.planUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    result.duration = profile.getDuration();
+    // time it takes to slow down from the start velocity to any limit
+    const float settle = std::fabs(test.startVelocity) / MAX_ACCELERATION + 2 * MAX_ACCELERATION / maxJerk;
+    lemlib::ProfileState prev = profile.sample(0);
+    for (float time = SAMPLE_TIME; time < result.duration + SAMPLE_TIME; time += SAMPLE_TIME) {
+        // the last sample is the end of the profile, which can be closer than the sample time
+        const lemlib::ProfileState state = profile.sample(time);
+        const float dt = state.time - prev.time;
+        if (dt < 1e-6) continue;
+        result.maxJerk = std::max(result.maxJerk, std::fabs(state.acceleration - prev.acceleration) / dt);
+        result.maxAcceleration = std::max(result.maxAcceleration, std::fabs(state.acceleration));
+        result.jump = std::max(result.jump,
+                               std::fabs(state.position - prev.position - (state.velocity + prev.velocity) / 2 * dt));
+        const float overLimit = state.velocity - limitAt(test, state.position);
+        if (time > settle) result.overLimit = std::max(result.overLimit, overLimit);
+        prev = state;
+    }
+    if (profile.sample(result.duration).position != test.distance) result.jump = INFINITY;
+    result.endVelocity = profile.sample(result.duration).velocity;
+    return result;
+}
+} // namespace
+
+int main() {
+    bool pass = true;
+    const std::vector<Case> cases = {
+        {"short, 2in", 2, {60}},
+        {"short, 12in", 12, {60}},
+        {"long, 48in", 48, {60}},
+        {"long, 120in", 120, {60}},
+        {"chained, 24in to 30in/s", 24, {60}, 0, 30},
+        {"slow down partway", 96, {60, 20, 60}},
+        {"path, 5 limits", 72, {60, 45, 15, 40, 60}},
+        {"moving, 40in/s", 24, {60}, 40},
+        {"too fast to stop, 60in/s", 6, {60}, 60},
+        {"above the limit, 60in/s", 48, {30}, 60},
+        {"backwards, -20in/s", 24, {60}, -20},
+        {"backwards, -50in/s", 4, {60}, -50},
+    };
+    // the larger jerk is more than the profile can ramp over in a few steps, so the profile lowers it
+    for (const float maxJerk : {600.0f, 5000.0f}) {
+        std::printf("jerk limited motion profiles, %g in/s^2, %g in/s^3, sampled every %gms\n", MAX_ACCELERATION,
+                    maxJerk, SAMPLE_TIME * 1000);
+        std::printf("%-26s %9s %9s %10s %11s %9s %13s %10s\n", "case", "time (s)", "max jerk", "max accel",
+                    "over limit", "jump (in)", "end velocity", "plan (us)");
+        for (const Case& test : cases) {
+            const Result result = run(test, maxJerk);
+            std::printf("%-26s %9.3f %9.1f %10.1f %11.3f %9.4f %13.2f %10.0f\n", test.name, result.duration,
+                        result.maxJerk, result.maxAcceleration, result.overLimit, result.jump, result.endVelocity,
+                        result.planUs);
+            if (result.maxJerk > maxJerk * (1 + TOLERANCE)) pass = false;
+            if (result.maxAcceleration > MAX_ACCELERATION * (1 + TOLERANCE)) pass = false;
+            if (result.overLimit > TOLERANCE * limitAt(test, test.distance / 2)) pass = false;
+            if (result.jump > JUMP_TOLERANCE) pass = false;
+        }
+        std::printf("\n");
+    }
+    if (!pass) std::printf("FAILED\n");
+    return !pass;
+}
@@ -0,0 +1,80 @@
+// Host stand-ins for the PROS functions LemLib links against, so it can be built and benchmarked on a computer.
+// Devices are only used through pointers, so only the functions below are needed. Tasks run on threads, and time
+// is the host's clock
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "pros/adi.hpp"
+#include "pros/device.hpp"
+#include "pros/misc.h"
+#include "pros/misc.hpp"
+#include "pros/rtos.h"
+#include "pros/rtos.hpp"
+
+namespace {
+const auto start = std::chrono::steady_clock::now();
+
+std::timed_mutex* hostMutex(std::atomic<pros::mutex_t>& handle) {
+    pros::mutex_t expected = nullptr;
+    auto* created = new std::timed_mutex;
+    if (!handle.compare_exchange_strong(expected, created)) {
+        delete created;
+        return static_cast<std::timed_mutex*>(expected);
+    }
+    return created;
+}
+} // namespace
+
+uint32_t pros::c::millis(void) {
+    // PROS starts counting from 1, so 0 can mean "never"
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() + 1;
+}
+
+uint64_t pros::c::micros(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() + 1;
+}
+
+void pros::c::delay(const uint32_t milliseconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+int32_t pros::c::controller_rumble(controller_id_e_t, const char*) { return 1; }
+
+pros::Task::Task(task_fn_t function, void* parameters, std::uint32_t, std::uint16_t, const char*) {
+    std::thread(function, parameters).detach();
+}
+
+void pros::Task::delay_until(std::uint32_t* const prev_time, const std::uint32_t delta) {
+    *prev_time += delta;
+    const std::uint32_t now = pros::c::millis();
+    if (*prev_time > now) pros::c::delay(*prev_time - now);
+}
+
+pros::mutex_t pros::Mutex::lazy_init() { return hostMutex(mutex); }
+
+bool pros::Mutex::take() {
+    static_cast<std::timed_mutex*>(lazy_init())->lock();
+    return true;
+}
+
+bool pros::Mutex::take(std::uint32_t timeout) {
+    return static_cast<std::timed_mutex*>(lazy_init())->try_lock_for(std::chrono::milliseconds(timeout));
+}
+
+bool pros::Mutex::give() {
+    static_cast<std::timed_mutex*>(lazy_init())->unlock();
+    return true;
+}
+
+// detached tasks can still hold the mutex when static objects are destroyed, so it's never freed
+pros::Mutex::~Mutex() {}
+
+std::int32_t pros::adi::Encoder::get_value() const { return 0; }
+
+std::int32_t pros::adi::Encoder::reset() const { return 1; }
+
+std::uint8_t pros::Device::get_port() const { return 0; }
+
+std::int32_t pros::battery::get_voltage() { return 12000; }
+
+std::uint8_t pros::competition::get_status() { return 0; }
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "lemlib/pid.hpp" // IWYU pragma: keep
+#include "lemlib/autotune.hpp" // IWYU pragma: keep
+#include "lemlib/motionProfile.hpp" // IWYU pragma: keep
+#include "lemlib/mpc.hpp" // IWYU pragma: keep
+#include "lemlib/planner.hpp" // IWYU pragma: keep
 #include "lemlib/pose.hpp" // IWYU pragma: keep
 #include "lemlib/util.hpp" // IWYU pragma: keep
 #include "lemlib/chassis/chassis.hpp"
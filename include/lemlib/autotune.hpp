@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cmath>
+
+namespace lemlib {
+/**
+ * @brief Enum class TuningRule
+ *
+ * How PID gains are calculated from the ultimate gain and period measured by Chassis::autotune. The rules are
+ * ordered from most aggressive to least aggressive
+ */
+enum class TuningRule {
+    ZIEGLER_NICHOLS, /** classic Ziegler-Nichols. Fast, but overshoots */
+    SOME_OVERSHOOT, /** Ziegler-Nichols with some overshoot */
+    NO_OVERSHOOT, /** Ziegler-Nichols with no overshoot */
+    TYREUS_LUYBEN /** Tyreus-Luyben. Slower, with more robustness margin */
+};
+
+/**
+ * @brief Parameters for Chassis::autotune
+ *
+ * We use a struct to simplify customization. Chassis::autotune has many
+ * parameters and specifying them all just to set one optional param harms
+ * readability. By passing a struct to the function, we can have named
+ * parameters, overcoming the c/c++ limitation
+ */
+struct AutotuneParams {
+        /** how the gains are calculated. NO_OVERSHOOT by default */
+        TuningRule rule = TuningRule::NO_OVERSHOOT;
+        /** output of the relay. Value between 0-127. 40 by default */
+        float relayOutput = 40;
+        /** hysteresis of the relay, in inches or degrees. Stops sensor noise from switching the relay, but delays the
+         * switching, which makes the ultimate gain look smaller than it is. 0.1 by default */
+        float hysteresis = 0.1;
+        /** how many oscillations to measure. The first one is skipped since it isn't steady yet. 4 by default */
+        int cycles = 4;
+        /** whether the gains should include an integral term. false by default */
+        bool integral = false;
+        /** size of the step used to measure overshoot and settling time with the new gains, in inches or degrees. 0
+         * skips the step. 24 inches or 90 degrees by default */
+        float stepSize = NAN;
+        /** whether the chassis should start using the new gains. A gain schedule set on the controller's PID is kept,
+         * and still takes priority over the new gains. true by default */
+        bool apply = true;
+};
+
+/**
+ * @brief Result of Chassis::autotune
+ */
+struct AutotuneResult {
+        /** whether the relay experiment measured a steady oscillation */
+        bool success = false;
+        /** ultimate gain, in motor power per inch or degree */
+        float ku = 0;
+        /** ultimate period, in seconds */
+        float tu = 0;
+        /** amplitude of the oscillation, in inches or degrees */
+        float amplitude = 0;
+        /** proposed proportional gain */
+        float kP = 0;
+        /** proposed integral gain */
+        float kI = 0;
+        /** proposed derivative gain */
+        float kD = 0;
+        /** overshoot of the step with the new gains, as a fraction of the step size */
+        float overshoot = 0;
+        /** time the step with the new gains took to settle within the small error range, in milliseconds */
+        float settlingTime = 0;
+};
+
+/**
+ * @brief Relay feedback experiment
+ *
+ * The relay pushes the system away from where it started, and flips its output when the system has passed the start
+ * by the hysteresis. This makes the system oscillate at its ultimate period, and the ultimate gain is calculated from
+ * the amplitude of the oscillation. Chassis::autotune runs this on the chassis, but it doesn't use any hardware, so it
+ * can also be run on a simulated system
+ */
+class RelayExperiment {
+    public:
+        /**
+         * @brief Construct a new relay experiment
+         *
+         * @param params the relay output, hysteresis, number of cycles, and how the gains are calculated
+         */
+        RelayExperiment(const AutotuneParams& params);
+        /**
+         * @brief Update the relay
+         *
+         * @param position position of the system, relative to where it started
+         * @param time current time, in seconds
+         * @return float the output of the relay
+         *
+         * @b Example
+         * @code {.cpp}
+         * lemlib::RelayExperiment relay({});
+         * while (!relay.isDone()) {
+         *     motors.move(relay.update(getPosition(), pros::millis() / 1000.0));
+         *     pros::delay(10);
+         * }
+         * @endcode
+         */
+        float update(float position, float time);
+        /**
+         * @return whether enough cycles have been measured
+         */
+        bool isDone() const;
+        /**
+         * @brief Calculate the ultimate gain and period, and the gains from the tuning rule
+         *
+         * @return AutotuneResult the result. success is false if a steady oscillation wasn't measured. The step
+         * response isn't measured
+         */
+        AutotuneResult getResult() const;
+    private:
+        AutotuneParams params;
+        float relay;
+        float max = -INFINITY;
+        float min = INFINITY;
+        int cycles = 0; // how many times the relay flipped to positive
+        float cycleStart = 0;
+        float periodSum = 0;
+        float amplitudeSum = 0;
+        int measured = 0;
+};
+
+/**
+ * @brief Overshoot and settling time of a step response
+ */
+class StepResponse {
+    public:
+        /**
+         * @brief Start measuring a step response
+         *
+         * @param target the target of the step
+         * @param stepSize the size of the step
+         * @param smallError how close to the target the system has to be to count as settled
+         * @param time current time, in seconds
+         */
+        StepResponse(float target, float stepSize, float smallError, float time);
+        /**
+         * @brief Update the measurements
+         *
+         * @param position position of the system
+         * @param time current time, in seconds
+         */
+        void update(float position, float time);
+        /**
+         * @return float the largest overshoot so far, as a fraction of the step size
+         */
+        float getOvershoot() const;
+        /**
+         * @return float time from the start of the step until the system last entered the small error range, in
+         * seconds
+         */
+        float getSettlingTime() const;
+    private:
+        float target;
+        float stepSize;
+        float smallError;
+        float start;
+        float lastOutside; // last time the error was outside the small error range
+        float overshoot = 0;
+};
+} // namespace lemlib
@@ -1,11 +1,18 @@
 #pragma once
 
 #include "pros/rtos.hpp"
+#include <cmath>
+#include <array>
+#include <vector>
+#include <utility>
 #include "pros/imu.hpp"
+#include "pros/gps.hpp"
 #include "lemlib/asset.hpp"
 #include "lemlib/chassis/trackingWheel.hpp"
 #include "lemlib/pose.hpp"
 #include "lemlib/pid.hpp"
+#include "lemlib/mpc.hpp"
+#include "lemlib/autotune.hpp"
 #include "lemlib/exitcondition.hpp"
 #include "lemlib/driveCurve.hpp"
 
@@ -26,6 +33,7 @@ class OdomSensors {
          * @param horizontal1 pointer to the first horizontal tracking wheel
          * @param horizontal2 pointer to the second horizontal tracking wheel
          * @param imu pointer to the IMU
+         * @param gps pointer to the GPS sensor. nullptr by default
          *
          * @b Example
          * @code {.cpp}
@@ -41,12 +49,113 @@ class OdomSensors {
          * @endcode
          */
         OdomSensors(TrackingWheel* vertical1, TrackingWheel* vertical2, TrackingWheel* horizontal1,
-                    TrackingWheel* horizontal2, pros::Imu* imu);
+                    TrackingWheel* horizontal2, pros::Imu* imu, pros::Gps* gps = nullptr);
+        /**
+         * Using more than one IMU reduces heading drift. The IMUs are calibrated at the same time, IMUs that
+         * disagree with the others are rejected, and the rest are averaged
+         *
+         * @param vertical1 pointer to the first vertical tracking wheel
+         * @param vertical2 pointer to the second vertical tracking wheel
+         * @param horizontal1 pointer to the first horizontal tracking wheel
+         * @param horizontal2 pointer to the second horizontal tracking wheel
+         * @param imus pointers to the IMUs
+         * @param gps pointer to the GPS sensor. nullptr by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * pros::Rotation vertical_rotation(1); // rotation sensor on port 1
+         * pros::Imu imu1(2); // IMU on port 2
+         * pros::Imu imu2(3); // IMU on port 3
+         * pros::Imu imu3(4); // IMU on port 4
+         * // tracking wheel using a new 2.75" wheel, 0.5 inches to the right of the tracking center
+         * lemlib::TrackingWheel vertical1(&vertical_rotation, lemlib::Omniwheel::NEW_275, 0.5);
+         * lemlib::OdomSensors sensors(&vertical1, // vertical tracking wheel
+         *                     nullptr, // no second vertical tracking wheel, set to nullptr
+         *                     nullptr, // no horizontal tracking wheels, set to nullptr
+         *                     nullptr, // no second horizontal tracking wheel, set to nullptr
+         *                     {&imu1, &imu2, &imu3}); // IMUs
+         * @endcode
+         */
+        OdomSensors(TrackingWheel* vertical1, TrackingWheel* vertical2, TrackingWheel* horizontal1,
+                    TrackingWheel* horizontal2, std::vector<pros::Imu*> imus, pros::Gps* gps = nullptr);
         TrackingWheel* vertical1;
         TrackingWheel* vertical2;
         TrackingWheel* horizontal1;
         TrackingWheel* horizontal2;
+        /** the first IMU, or nullptr if there are none */
         pros::Imu* imu;
+        /** all the IMUs */
+        std::vector<pros::Imu*> imus;
+        /** GPS sensor used to correct the pose, or nullptr if there isn't one. The GPS offset has to be configured so
+         * it reports the position of the tracking center, and odometry has to use the GPS coordinate system: (0, 0) at
+         * the center of the field and heading 0 facing the same wall as GPS heading 0 */
+        pros::Gps* gps;
+};
+
+/**
+ * @brief OdomIntegration
+ *
+ * How odometry turns a change in local position into a change in global position
+ */
+enum class OdomIntegration {
+    ARC, /** single precision arc approximation. Cheapest, but accumulates rounding error over long runs */
+    EXACT /** exact SE(2) exponential map with double precision, compensated accumulation */
+};
+
+/**
+ * @brief HeadingFusion
+ *
+ * How odometry calculates the heading of the robot
+ */
+enum class HeadingFusion {
+    PRIORITY, /** use the single best sensor available: horizontal wheels, then vertical wheels, then the IMU */
+    COMPLEMENTARY /** blend the tracking wheels, the IMU gyro rate and the IMU heading with a complementary filter */
+};
+
+/**
+ * @brief Calibration status
+ *
+ * Status of the IMU calibration started by Chassis::calibrate
+ */
+enum class CalibrationStatus {
+    NOT_STARTED, /** calibration hasn't been started */
+    CALIBRATING, /** the IMUs are calibrating */
+    DONE, /** at least one IMU calibrated successfully, or there are no IMUs to calibrate */
+    FAILED /** every IMU failed to calibrate. Odometry uses the tracking wheels / motor encoders instead */
+};
+
+/**
+ * @brief Settings for the odometry task
+ *
+ * We use a struct to simplify customization. Odometry has several optional
+ * settings and specifying them all just to set one harms readability. By
+ * passing a struct, we can have named parameters, overcoming the c/c++ limitation
+ */
+struct OdomSettings {
+        /** how often odometry updates, in milliseconds. The data rate of the IMU and rotation sensors is set to match.
+         * Minimum of 5, 10 by default */
+        std::uint32_t rate = 10;
+        /** how local position changes are integrated into the global pose. ARC by default */
+        OdomIntegration integration = OdomIntegration::ARC;
+        /** how the heading is calculated. PRIORITY by default. COMPLEMENTARY requires an IMU mounted flat */
+        HeadingFusion headingFusion = HeadingFusion::PRIORITY;
+        /** time constant of the complementary filter, in seconds. Lower values trust the IMU heading more, higher
+         * values trust the tracking wheels and gyro rate more. 0.5 by default */
+        float headingTimeConstant = 0.5;
+        /** whether to estimate the scale factor error of the IMU against unpowered tracking wheels when using
+         * COMPLEMENTARY heading fusion. true by default */
+        bool estimateImuScale = true;
+        /** how often the GPS sends new data and is fused, in milliseconds. Minimum of 5, 20 by default */
+        std::uint32_t gpsRate = 20;
+        /** GPS readings are ignored while the GPS reports a larger RMS error than this, in inches. 2 by default */
+        float gpsMaxError = 2;
+        /** how old the GPS readings are when they are received, in seconds. 0.03 by default */
+        float gpsLatency = 0.03;
+        /** time constant of the GPS correction, in seconds. Lower values trust the GPS more, higher values trust the
+         * other sensors more. 1 by default */
+        float gpsTimeConstant = 1;
+        /** whether the GPS also corrects the heading. true by default */
+        bool gpsHeading = true;
 };
 
 /**
@@ -73,6 +182,14 @@ class ControllerSettings {
          * @param largeErrorTimeout the time the chassis controller will wait before exiting if error is within a
          * certain range determined by largeError
          * @param slew maximum acceleration
+         * @param settleRate the chassis controller will exit early if the error is within the small error range and
+         * changes slower than this, per second, for settleTime. 0 disables early exit. 0 by default
+         * @param settleVelocity largest chassis velocity for an early exit, in inches or degrees per second. 0 to not
+         * check the velocity. 0 by default
+         * @param settleTime the time the error has to be settled before an early exit, in milliseconds. 20 by default
+         * @param settleWindow how many recent errors have to vary less than settleDeviation for an early exit. At most
+         * 16. 0 to not check them. 0 by default
+         * @param settleDeviation largest standard deviation of the recent errors for an early exit. 0 by default
          *
          * @b Example
          * @code {.cpp}
@@ -86,9 +203,28 @@ class ControllerSettings {
          *                                            500, // large error range timeout, in milliseconds
          *                                            5); // maximum acceleration (slew)
          * @endcode
+         * @code {.cpp}
+         * // exit as soon as the robot is settled, instead of waiting for the small error timeout
+         * lemlib::ControllerSettings lateralSettings(10, // proportional gain (kP)
+         *                                            0, // integral gain (kI), set to 0 to disable
+         *                                            3, // derivative gain (kD), set to 3
+         *                                            3, // integral anti windup range, set to 0 to disable
+         *                                            1, // small error range, in inches
+         *                                            100, // small error range timeout, in milliseconds
+         *                                            3, // large error range, in inches
+         *                                            500, // large error range timeout, in milliseconds
+         *                                            5, // maximum acceleration (slew)
+         *                                            2, // settled if the error changes slower than 2 inches per second
+         *                                            1, // and the robot moves slower than 1 inch per second
+         *                                            20, // for 20 milliseconds
+         *                                            10, // and the last 10 errors
+         *                                            0.1); // have a standard deviation under 0.1 inches
+         * @endcode
          */
         ControllerSettings(float kP, float kI, float kD, float windupRange, float smallError, float smallErrorTimeout,
-                           float largeError, float largeErrorTimeout, float slew)
+                           float largeError, float largeErrorTimeout, float slew, float settleRate = 0,
+                           float settleVelocity = 0, float settleTime = 20, int settleWindow = 0,
+                           float settleDeviation = 0)
             : kP(kP),
               kI(kI),
               kD(kD),
@@ -97,7 +233,12 @@ class ControllerSettings {
               smallErrorTimeout(smallErrorTimeout),
               largeError(largeError),
               largeErrorTimeout(largeErrorTimeout),
-              slew(slew) {}
+              slew(slew),
+              settleRate(settleRate),
+              settleVelocity(settleVelocity),
+              settleTime(settleTime),
+              settleWindow(settleWindow),
+              settleDeviation(settleDeviation) {}
 
         float kP;
         float kI;
@@ -108,6 +249,11 @@ class ControllerSettings {
         float largeError;
         float largeErrorTimeout;
         float slew;
+        float settleRate;
+        float settleVelocity;
+        float settleTime;
+        int settleWindow;
+        float settleDeviation;
 };
 
 /**
@@ -196,6 +342,9 @@ struct TurnToPointParams {
         /** angle between the robot and target point where the movement will exit. Only has an effect if minSpeed is
          * non-zero.*/
         float earlyExitRange = 0;
+        /** whether to follow a motion profile instead of using the angular PID alone. The profile is set with
+         * Chassis::setProfileSettings. false by default */
+        bool profiled = false;
 };
 
 /**
@@ -217,6 +366,9 @@ struct TurnToHeadingParams {
         /** angle between the robot and target point where the movement will exit. Only has an effect if minSpeed is
          * non-zero.*/
         float earlyExitRange = 0;
+        /** whether to follow a motion profile instead of using the angular PID alone. The profile is set with
+         * Chassis::setProfileSettings. false by default */
+        bool profiled = false;
 };
 
 /**
@@ -253,6 +405,9 @@ struct SwingToPointParams {
         /** angle between the robot and target heading where the movement will exit. Only has an effect if minSpeed is
          * non-zero.*/
         float earlyExitRange = 0;
+        /** whether to follow a motion profile around the locked wheel. The moving side follows the angular profile
+         * with feedforward, and the locked side is held in place with the lateral PID. false by default */
+        bool profiled = false;
 };
 
 /**
@@ -274,6 +429,9 @@ struct SwingToHeadingParams {
         /** angle between the robot and target heading where the movement will exit. Only has an effect if minSpeed is
          * non-zero.*/
         float earlyExitRange = 0;
+        /** whether to follow a motion profile around the locked wheel. The moving side follows the angular profile
+         * with feedforward, and the locked side is held in place with the lateral PID. false by default */
+        bool profiled = false;
 };
 
 /**
@@ -321,6 +479,234 @@ struct MoveToPointParams {
         /** distance between the robot and target point where the movement will exit. Only has an effect if minSpeed is
          * non-zero.*/
         float earlyExitRange = 0;
+        /** whether to follow a motion profile instead of using the lateral PID alone. The profile is set with
+         * Chassis::setProfileSettings. false by default */
+        bool profiled = false;
+};
+
+/**
+ * @brief Parameters for Chassis::driveArc and Chassis::driveCurvature
+ *
+ * We use a struct to simplify customization. By passing a struct to the function, we can have named parameters,
+ * overcoming the c/c++ limitation
+ */
+struct DriveArcParams {
+        /** the maximum speed the faster side of the drivetrain can travel at. Value between 0-127. 127 by default */
+        float maxSpeed = 127;
+        /** the minimum speed the robot can travel at. If set to a non-zero value, the robot will still be moving at
+         * this speed at the end of the arc. Value between 0-127. 0 by default */
+        float minSpeed = 0;
+        /** distance before the end of the arc where the movement will exit. Only has an effect if minSpeed is
+         * non-zero.*/
+        float earlyExitRange = 0;
+        /** how far ahead the robot aims to rejoin the arc when it has drifted off it, in inches. Smaller values correct
+         * more aggressively. 12 by default */
+        float correctionDistance = 12;
+};
+
+/**
+ * @brief A point for Chassis::moveThrough to pass through
+ */
+struct Waypoint {
+        /** x position, in inches */
+        float x;
+        /** y position, in inches */
+        float y;
+        /** heading the robot should have when it passes through the point, in degrees. NAN lets the path choose a
+         * smooth heading. NAN by default */
+        float theta = NAN;
+};
+
+/**
+ * @brief Parameters for Chassis::moveThrough
+ *
+ * We use a struct to simplify customization. By passing a struct to the function, we can have named parameters,
+ * overcoming the c/c++ limitation
+ */
+struct MoveThroughParams {
+        /** whether the robot should move forwards or backwards. True by default */
+        bool forwards = true;
+        /** the lookahead distance of the path follower, in inches. Larger values follow the path more smoothly but
+         * less accurately. 10 by default */
+        float lookahead = 10;
+        /** the maximum speed the faster side of the drivetrain can travel at. Value between 0-127. 127 by default */
+        float maxSpeed = 127;
+        /** the minimum speed the robot can travel at. If set to a non-zero value, the robot will still be moving at
+         * this speed at the end of the path. Value between 0-127. 0 by default */
+        float minSpeed = 0;
+        /** distance before the end of the path where the movement will exit. Only has an effect if minSpeed is
+         * non-zero.*/
+        float earlyExitRange = 0;
+        /** whether to track the path with the model predictive controller instead of pure pursuit. It plans ahead, so
+         * it handles upcoming curves and saturating motors better. The controller is set with Chassis::setMPCSettings.
+         * false by default */
+        bool mpc = false;
+};
+
+/**
+ * @brief Settings for motion profiled motions
+ *
+ * Lateral settings are in inches, angular settings are in degrees
+ */
+struct ProfileSettings {
+        /** maximum velocity, per second. 0 uses the top speed of the drivetrain. 0 by default */
+        float maxVelocity = 0;
+        /** maximum acceleration, per second squared. 100 by default */
+        float maxAcceleration = 100;
+        /** maximum jerk, per second cubed. 0 for no limit (trapezoidal profile). 0 by default */
+        float maxJerk = 0;
+        /** motor power needed to overcome static friction. 0 by default */
+        float kS = 0;
+        /** motor power per unit of velocity. 0 calculates it from the top speed of the drivetrain. 0 by default */
+        float kV = 0;
+        /** motor power per unit of acceleration. 0 by default */
+        float kA = 0;
+        /** motor power per unit of velocity error. The velocity is measured by odometry, which uses the gyro rate of
+         * the IMU when heading fusion is enabled. 0 by default */
+        float kVelocity = 0;
+};
+
+/**
+ * @brief Enum class Desaturation
+ *
+ * How lateral and angular power are combined when together they need more power than the drivetrain can give
+ */
+enum class Desaturation {
+    AUTO, /** use what each motion was designed for */
+    PROPORTIONAL, /** scale both down by the same amount, which keeps the curvature of the motion */
+    ANGULAR_PRIORITY, /** reduce lateral power first, so the robot keeps turning */
+    LATERAL_PRIORITY /** reduce angular power first, so the robot keeps driving */
+};
+
+/**
+ * @brief Settings for the drivetrain output stage
+ *
+ * Every motion and driver control function sends its output through the same stage, which applies these settings
+ * before the power is sent to the motors
+ */
+struct OutputSettings {
+        /** maximum change in power of each side per 10ms. 0 for no limit. 0 by default */
+        float slew = 0;
+        /** maximum change in the rate of change of power of each side per 10ms, per 10ms. Smooths the start and end of
+         * acceleration. 0 for no limit. 0 by default */
+        float jerk = 0;
+        /** power the motors need before the drivetrain starts moving. Non-zero power is scaled to start from here, so
+         * small outputs still move the robot. Not used if the drivetrain is calibrated. 0 by default */
+        float deadband = 0;
+        /** how to combine lateral and angular power when they exceed the maximum. AUTO by default */
+        Desaturation desaturation = Desaturation::AUTO;
+        /** whether to skip sending the motors a voltage they were just sent, to reduce smart port traffic. The voltage
+         * is still sent at least every 100ms. true by default */
+        bool skipRedundantWrites = true;
+};
+
+/**
+ * @brief Settings for heading hold during driver control
+ *
+ * While the driver drives without turning, Chassis::arcade and Chassis::curvature lock the heading of the robot and
+ * correct it, so the robot drives straight when it's pushed or when the sides of the drivetrain are mismatched
+ */
+struct HeadingHoldSettings {
+        /** proportional gain, in power per degree of error. 3 by default */
+        float kP = 3;
+        /** integral gain. 0 by default */
+        float kI = 0;
+        /** derivative gain. 10 by default */
+        float kD = 10;
+        /** turn input, after the drive curve, that counts as not turning. 5 by default */
+        float deadband = 5;
+        /** how long the driver has to stop turning before the heading is locked, in milliseconds. Lets the robot stop
+         * turning first. 150 by default */
+        std::uint32_t lockDelay = 150;
+        /** how long the correction takes to fade out when the driver starts turning, in milliseconds. 150 by default
+         */
+        std::uint32_t releaseTime = 150;
+        /** maximum correction. Value between 0-127. 60 by default */
+        float maxCorrection = 60;
+};
+
+/**
+ * @brief Enum class StallAction
+ *
+ * What a motion does when it detects the robot has stalled, e.g by driving into a wall or a game element
+ */
+enum class StallAction {
+    NONE, /** ignore stalls. The motion continues until it exits normally */
+    EXIT, /** end the motion and stop the drivetrain */
+    BACK_OFF, /** end the motion, and briefly drive in the opposite direction to release the contact */
+    HOLD /** end the motion, and hold the drivetrain in place with the motors' velocity controllers */
+};
+
+/**
+ * @brief Settings for stall detection
+ *
+ * The robot is stalled when it's commanded to move but moves much slower than commanded, while either the motors
+ * draw a lot of current or the IMU measured an impact, for the stall time
+ */
+struct StallSettings {
+        /** what to do when a stall is detected. NONE by default */
+        StallAction action = StallAction::NONE;
+        /** smallest commanded power for a side of the drivetrain to be considered stalled. 20 by default */
+        float minPower = 20;
+        /** a side is too slow if it moves slower than this fraction of the speed it's commanded to. 0.25 by default */
+        float speedRatio = 0.25;
+        /** average current draw of a side of the drivetrain above which the motors are straining, in milliamps.
+         * 1800 by default */
+        float current = 1800;
+        /** horizontal acceleration measured by the IMU that counts as an impact, in g. 0 disables. 1 by default */
+        float impact = 1;
+        /** how long the robot has to be stalled before the action is taken, in milliseconds. 100 by default */
+        int time = 100;
+        /** how long after a motion starts before stalls are detected, so accelerating from rest isn't mistaken for a
+         * stall, in milliseconds. 300 by default */
+        int startupTime = 300;
+        /** power to back off with. 40 by default */
+        float backOffPower = 40;
+        /** how long to back off for, in milliseconds. 150 by default */
+        int backOffTime = 150;
+};
+
+/**
+ * @brief Enum class Axis
+ *
+ * Which chassis controller to tune with Chassis::autotune
+ */
+enum class Axis {
+    LATERAL, /** the lateral controller, used to drive forwards and backwards */
+    ANGULAR /** the angular controller, used to turn */
+};
+
+/**
+ * @brief Parameters for Chassis::calibrateDrive
+ *
+ * We use a struct to simplify customization. Chassis::calibrateDrive has many
+ * parameters and specifying them all just to set one optional param harms
+ * readability. By passing a struct to the function, we can have named
+ * parameters, overcoming the c/c++ limitation
+ */
+struct DriveCalibrationParams {
+        /** difference in power between the commands of the sweep. Value between 1-127. 4 by default */
+        float step = 4;
+        /** time each command is held before the velocity is measured, in milliseconds. 250 by default */
+        int settleTime = 250;
+        /** time the velocity is averaged over, in milliseconds. 100 by default */
+        int sampleTime = 100;
+        /** whether the chassis should start using the calibration. true by default */
+        bool apply = true;
+};
+
+/**
+ * @brief Calibration of the drivetrain motors, measured by Chassis::calibrateDrive
+ *
+ * Maps the power a motion asks for to the power that makes the motors move at that fraction of their top speed
+ */
+struct DriveCalibration {
+        /** whether the calibration is valid */
+        bool success = false;
+        /** power the left side needs for every output power from 0 to 127 */
+        std::array<float, 128> left {};
+        /** power the right side needs for every output power from 0 to 127 */
+        std::array<float, 128> right {};
 };
 
 // default drive curve
@@ -349,7 +735,13 @@ class Chassis {
         /**
          * @brief Calibrate the chassis sensors. THis should be called in the initialize function
          *
+         * If blocking is false, this returns immediately and the IMUs calibrate in the background. Odometry starts
+         * tracking with the tracking wheels straight away, and switches to the IMUs once they finish calibrating. The
+         * robot should still be kept still while the IMUs calibrate
+         *
          * @param calibrateIMU whether the IMU should be calibrated. true by default
+         * @param odomSettings settings for the odometry task
+         * @param blocking whether to wait for the IMUs to finish calibrating. true by default
          *
          * @b Example
          * @code {.cpp}
@@ -366,8 +758,52 @@ class Chassis {
          *     chassis.calibrate(false);
          * }
          * @endcode
+         * @code {.cpp}
+         * // initialize function in your project. The first function that runs when the program is started
+         * void initialize() {
+         *     // calibrate the IMU, and update odometry every 5ms instead of every 10ms
+         *     chassis.calibrate(true, {.rate = 5});
+         * }
+         * @endcode
+         * @code {.cpp}
+         * // initialize function in your project. The first function that runs when the program is started
+         * void initialize() {
+         *     // calibrate the IMU in the background
+         *     chassis.calibrate(true, {}, false);
+         * }
+         * @endcode
+         */
+        void calibrate(bool calibrateIMU = true, OdomSettings odomSettings = {}, bool blocking = true);
+        /**
+         * @brief Get the status of the IMU calibration
+         *
+         * @return CalibrationStatus
+         *
+         * @b Example
+         * @code {.cpp}
+         * // show whether the IMUs are still calibrating
+         * if (chassis.getCalibrationStatus() == lemlib::CalibrationStatus::CALIBRATING) {
+         *     pros::lcd::print(0, "Calibrating...");
+         * }
+         * @endcode
+         */
+        CalibrationStatus getCalibrationStatus() const;
+        /**
+         * @brief Wait until the IMUs have finished calibrating
+         *
+         * @param timeout longest time to wait, in milliseconds. Waits forever by default
+         * @return CalibrationStatus the status once calibration finished, or CALIBRATING if the timeout was reached
+         *
+         * @b Example
+         * @code {.cpp}
+         * void autonomous() {
+         *     // make sure the IMUs are calibrated before moving
+         *     chassis.waitUntilCalibrated();
+         *     chassis.moveToPoint(10, 10, 4000);
+         * }
+         * @endcode
          */
-        void calibrate(bool calibrateIMU = true);
+        CalibrationStatus waitUntilCalibrated(std::uint32_t timeout = TIMEOUT_MAX);
         /**
          * @brief Set the pose of the chassis
          *
@@ -466,6 +902,22 @@ class Chassis {
          * @endcode
          */
         void waitUntilDone();
+        /**
+         * @brief Wait until the robot has passed a waypoint of Chassis::moveThrough
+         *
+         * @param index index of the waypoint, starting at 0
+         *
+         * @b Example
+         * @code {.cpp}
+         * // move through 3 points
+         * chassis.moveThrough({{0, 24}, {24, 24}, {24, 48, 0}}, 4000);
+         * // wait until the robot has passed the second point
+         * chassis.waitUntilWaypoint(1);
+         * // start the intake
+         * intake.move(127);
+         * @endcode
+         */
+        void waitUntilWaypoint(int index);
         /**
          * @brief Sets the brake mode of the drivetrain motors
          *
@@ -680,6 +1132,51 @@ class Chassis {
          * @endcode
          */
         void moveToPoint(float x, float y, int timeout, MoveToPointParams params = {}, bool async = true);
+        /**
+         * @brief Drive the chassis along an arc
+         *
+         * The wheel speeds are calculated from the track width so the robot drives along the arc exactly, and the
+         * speed along the arc follows the lateral motion profile set with Chassis::setProfileSettings. Odometry is
+         * used to correct the distance, heading and radius
+         *
+         * @param radius radius of the arc, in inches. Positive values curve to the right, negative values curve to
+         * the left
+         * @param angle how far to travel around the arc, in degrees. Negative values drive backwards
+         * @param timeout longest time the robot can spend moving
+         * @param params struct to simulate named parameters
+         * @param async whether the function should be run asynchronously. true by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // drive a quarter circle with a radius of 24 inches, curving to the right
+         * chassis.driveArc(24, 90, 4000);
+         * // drive backwards along a half circle with a radius of 12 inches, at up to half speed
+         * chassis.driveArc(-12, -180, 4000, {.maxSpeed = 64});
+         * @endcode
+         */
+        void driveArc(float radius, float angle, int timeout, DriveArcParams params = {}, bool async = true);
+        /**
+         * @brief Drive the chassis a distance with a constant curvature
+         *
+         * Same as Chassis::driveArc, but the arc is given by its curvature, so it can also be a straight line
+         *
+         * @param curvature curvature of the arc, in 1/inches. Positive values curve to the right, negative values
+         * curve to the left, and 0 drives straight
+         * @param distance distance to travel along the arc, in inches. Negative values drive backwards
+         * @param timeout longest time the robot can spend moving
+         * @param params struct to simulate named parameters
+         * @param async whether the function should be run asynchronously. true by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // drive 36 inches forwards while curving gently to the left
+         * chassis.driveCurvature(-0.02, 36, 4000);
+         * // drive 24 inches backwards in a straight line, and keep moving at the end
+         * chassis.driveCurvature(0, -24, 4000, {.minSpeed = 40, .earlyExitRange = 2});
+         * @endcode
+         */
+        void driveCurvature(float curvature, float distance, int timeout, DriveArcParams params = {},
+                            bool async = true);
         /**
          * @brief Move the chassis along a path
          *
@@ -708,6 +1205,201 @@ class Chassis {
          * @endcode
          */
         void follow(const asset& path, float lookahead, int timeout, bool forwards = true, bool async = true);
+        /**
+         * @brief Move the chassis through a sequence of points
+         *
+         * A smooth spline is fitted through the robot and the points, and one motion profile is planned along all of
+         * it, slowing down for tight corners. The path is tracked with the path follower, so the robot doesn't slow
+         * down between the points like it does when moveToPoint motions are chained
+         *
+         * @param waypoints points to move through, in order. Each one can set the heading the robot passes it with
+         * @param timeout longest time the robot can spend moving
+         * @param params struct to simulate named parameters
+         * @param async whether the function should be run asynchronously. true by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // move through (0, 24) and (24, 24), and end at (24, 48) facing heading 0
+         * chassis.moveThrough({{0, 24}, {24, 24}, {24, 48, 0}}, 4000);
+         * // move backwards through 2 points at up to half speed
+         * chassis.moveThrough({{0, -24}, {-24, -48}}, 4000, {.forwards = false, .maxSpeed = 64});
+         * @endcode
+         */
+        void moveThrough(const std::vector<Waypoint>& waypoints, int timeout, MoveThroughParams params = {},
+                         bool async = true);
+        /**
+         * @brief Tune a chassis controller with a relay feedback experiment
+         *
+         * The chassis is driven with a fixed output that flips direction whenever it crosses its starting position,
+         * which makes it oscillate. The amplitude and period of the oscillation give the ultimate gain and period of
+         * the chassis, which the tuning rule turns into PID gains. The new gains are then tested with a step, which
+         * measures the overshoot and settling time. The robot needs room to move around its starting position
+         *
+         * This blocks until the tuning is done, or until the timeout is reached
+         *
+         * @param axis which controller to tune
+         * @param timeout the maximum time the tuning can take
+         * @param params struct to simulate named parameters
+         * @return AutotuneResult the measured constants, proposed gains, and step response
+         *
+         * @b Example
+         * @code {.cpp}
+         * void autonomous() {
+         *     // tune the angular controller
+         *     lemlib::AutotuneResult result = chassis.autotune(lemlib::Axis::ANGULAR, 10000);
+         *     // print the proposed gains
+         *     printf("kP: %f, kI: %f, kD: %f\n", result.kP, result.kI, result.kD);
+         *     // tune the lateral controller with a more aggressive rule, without using the new gains
+         *     chassis.autotune(lemlib::Axis::LATERAL, 10000,
+         *                      {.rule = lemlib::TuningRule::SOME_OVERSHOOT, .apply = false});
+         * }
+         * @endcode
+         */
+        AutotuneResult autotune(Axis axis, int timeout, AutotuneParams params = {});
+        /**
+         * @brief Get the result of the last time a controller was tuned
+         *
+         * @param axis which controller
+         * @return AutotuneResult the result. success is false if the controller hasn't been tuned
+         *
+         * @b Example
+         * @code {.cpp}
+         * // check the last proposed gains for the lateral controller
+         * lemlib::AutotuneResult result = chassis.getAutotuneResult(lemlib::Axis::LATERAL);
+         * @endcode
+         */
+        AutotuneResult getAutotuneResult(Axis axis) const;
+        /**
+         * @brief Calibrate the drivetrain motors
+         *
+         * The motors don't move until they get enough power, and their speed isn't proportional to their power near
+         * zero. This sweeps the power from 0 to 127 while the robot turns in place, and measures the steady-state
+         * speed of each side at every step. The measurements are inverted into a table that the drivetrain output
+         * uses in place of the deadband in the output settings, so a small output still moves the robot, and the
+         * speed of each side is proportional to its output.
+         *
+         * This blocks until the calibration is done, or until the timeout is reached
+         *
+         * @param timeout the maximum time the calibration can take
+         * @param params struct to simulate named parameters
+         * @return DriveCalibration the calibration. success is false if it timed out or the drivetrain didn't move
+         *
+         * @b Example
+         * @code {.cpp}
+         * void autonomous() {
+         *     // calibrate the drivetrain, and start using the calibration
+         *     lemlib::DriveCalibration calibration = chassis.calibrateDrive(20000);
+         *     // print the power each side needs to start moving
+         *     printf("left: %f, right: %f\n", calibration.left[1], calibration.right[1]);
+         * }
+         * @endcode
+         */
+        DriveCalibration calibrateDrive(int timeout, DriveCalibrationParams params = {});
+        /**
+         * @brief Set the calibration of the drivetrain motors
+         *
+         * This is useful to use a calibration saved from an earlier run of Chassis::calibrateDrive
+         *
+         * @param calibration the calibration. If success is false, the drivetrain goes back to using the deadband in
+         * the output settings
+         *
+         * @b Example
+         * @code {.cpp}
+         * // stop using the calibration
+         * chassis.setDriveCalibration({});
+         * @endcode
+         */
+        void setDriveCalibration(const DriveCalibration& calibration);
+        /**
+         * @brief Get the calibration of the drivetrain motors
+         *
+         * @return DriveCalibration the calibration. success is false if the drivetrain hasn't been calibrated
+         */
+        DriveCalibration getDriveCalibration() const;
+        /**
+         * @brief Set the motion profile settings used by profiled motions
+         *
+         * @param axis whether the settings are for driving (LATERAL) or turning (ANGULAR)
+         * @param settings the profile settings
+         *
+         * @b Example
+         * @code {.cpp}
+         * // accelerate at up to 120 inches per second squared, with a jerk of up to 600 inches per second cubed
+         * chassis.setProfileSettings(lemlib::Axis::LATERAL, {.maxAcceleration = 120, .maxJerk = 600, .kA = 0.2});
+         * // use the profile
+         * chassis.moveToPoint(0, 48, 4000, {.profiled = true});
+         * @endcode
+         */
+        void setProfileSettings(Axis axis, ProfileSettings settings);
+        /**
+         * @brief Set the settings of the model predictive controller used by motions with the mpc parameter
+         *
+         * @param settings the controller settings
+         *
+         * @b Example
+         * @code {.cpp}
+         * // look 0.75 seconds ahead, and care more about staying on the path
+         * chassis.setMPCSettings({.horizon = 15, .timeStep = 0.05, .crossWeight = 8});
+         * // use the controller
+         * chassis.moveThrough({{0, 24}, {24, 48}}, 4000, {.mpc = true});
+         * @endcode
+         */
+        void setMPCSettings(MPCSettings settings);
+        /**
+         * @brief Compensate the drivetrain output for the battery voltage
+         *
+         * Motor power is normally a fraction of the battery voltage, so the robot is faster on a fresh battery than on
+         * a flat one. With compensation, motor power is a fraction of the nominal voltage instead, and the voltage
+         * sent to the motors is scaled by the measured battery voltage, so tuned gains and profiles behave the same
+         * at any charge. If the battery can't supply the voltage, the output saturates. Setting the nominal voltage to
+         * the lowest battery voltage expected during a match keeps the full range of power available
+         *
+         * @param enabled whether to compensate for the battery voltage
+         * @param nominalVoltage voltage that full power corresponds to, in volts. 12 by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // full power is always 11.5 volts
+         * chassis.setVoltageCompensation(true, 11.5);
+         * @endcode
+         */
+        void setVoltageCompensation(bool enabled, float nominalVoltage = 12);
+        /**
+         * @brief Set the settings of the drivetrain output stage
+         *
+         * @param settings the output settings
+         *
+         * @b Example
+         * @code {.cpp}
+         * // limit how fast each side can change power, and compensate for 8 power of motor deadband
+         * chassis.setOutputSettings({.slew = 10, .jerk = 2, .deadband = 8});
+         * @endcode
+         */
+        void setOutputSettings(OutputSettings settings);
+        /**
+         * @brief Enable or disable heading hold during driver control
+         *
+         * While the driver is driving but not turning, arcade and curvature drive lock the heading once the robot has
+         * stopped turning, and correct it with a dedicated PID. When the driver turns, the hold is released and its
+         * correction fades out
+         *
+         * @param enabled whether heading hold is enabled
+         * @param settings the heading hold settings
+         *
+         * @b Example
+         * @code {.cpp}
+         * void opcontrol() {
+         *     // hold the heading with a stronger correction than the default
+         *     chassis.setHeadingHold(true, {.kP = 5, .kD = 15});
+         *     while (true) {
+         *         chassis.arcade(controller.get_analog(pros::E_CONTROLLER_ANALOG_LEFT_Y),
+         *                        controller.get_analog(pros::E_CONTROLLER_ANALOG_RIGHT_X));
+         *         pros::delay(10);
+         *     }
+         * }
+         * @endcode
+         */
+        void setHeadingHold(bool enabled, HeadingHoldSettings settings = {});
         /**
          * @brief Control the robot during the driver using the tank drive control scheme. In this control scheme one
          * joystick axis controls the left motors' forward and backwards movement of the robot, while the other joystick
@@ -895,6 +1587,58 @@ class Chassis {
          * @endcode
          */
         void resetLocalPosition();
+        /**
+         * @brief Enable or disable traction control
+         *
+         * When enabled, the lateral acceleration of moveToPoint, moveToPose and follow adapts to the wheel slip
+         * measured by odometry. The allowed change in output is cut while either side of the drivetrain slips more
+         * than the limit, and grows back while it doesn't, up to the slew set in the lateral controller settings
+         * (or no limit if the slew is 0). This lets motions accelerate as hard as the wheels can grip, instead of
+         * relying on a conservative fixed slew
+         *
+         * @param maxSlip slip ratio above which acceleration is reduced. 0 disables traction control. 0 by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // reduce acceleration if the wheels slip by more than 20%
+         * chassis.setTractionControl(0.2);
+         * // disable traction control
+         * chassis.setTractionControl(0);
+         * @endcode
+         */
+        void setTractionControl(float maxSlip);
+        /**
+         * @brief Configure stall detection
+         *
+         * When enabled, every motion checks whether the robot has stalled against something, and ends early with the
+         * configured action instead of pushing until its timeout
+         *
+         * @param settings stall detection settings
+         *
+         * @b Example
+         * @code {.cpp}
+         * // end motions as soon as the robot drives into something
+         * chassis.setStallDetection({.action = lemlib::StallAction::EXIT});
+         * // back off a little after driving into something
+         * chassis.setStallDetection({.action = lemlib::StallAction::BACK_OFF, .backOffPower = 30});
+         * // disable stall detection
+         * chassis.setStallDetection({});
+         * @endcode
+         */
+        void setStallDetection(StallSettings settings);
+        /**
+         * @return whether the last motion ended because the robot stalled
+         *
+         * @b Example
+         * @code {.cpp}
+         * // drive into the goal
+         * chassis.moveToPoint(0, 48, 2000, {.maxSpeed = 35}, false);
+         * if (chassis.isStalled()) {
+         *     // the goal was reached
+         * }
+         * @endcode
+         */
+        bool isStalled() const;
         /**
          * PIDs are exposed so advanced users can implement things like gain scheduling
          * Changes are immediate and will affect a motion in progress
@@ -918,11 +1662,164 @@ class Chassis {
          * @brief Dequeues this motion and permits queued task to run
          */
         void endMotion();
+        /**
+         * @brief Slew rate limiter that adapts to wheel slip if traction control is enabled
+         *
+         * @param target target value
+         * @param current current value
+         * @param maxChange maximum change. No maximum if set to 0
+         * @return float the limited value
+         */
+        float tractionSlew(float target, float current, float maxChange);
+        /**
+         * @brief Check if the robot has stalled. Should be called every iteration of a motion, after moving
+         *
+         * @param leftPower power commanded to the left side of the drivetrain
+         * @param rightPower power commanded to the right side of the drivetrain
+         * @return true the robot has stalled and the motion should end
+         * @return false the robot hasn't stalled, or stall detection is disabled
+         */
+        bool checkStall(float leftPower, float rightPower);
+        /**
+         * @brief Take the stall action if the motion ended because the robot stalled. Should be called after the
+         * drivetrain is stopped at the end of a motion
+         */
+        void applyStallAction();
+        /**
+         * @brief Get the profile settings of an axis, with the defaults filled in from the drivetrain
+         */
+        ProfileSettings getProfileSettings(Axis axis) const;
+        /**
+         * @brief Move to a point with a motion profile. Called by moveToPoint once the motion has started
+         */
+        void moveToPointProfiled(float x, float y, int timeout, MoveToPointParams params);
+        /**
+         * @brief Turn to a heading with a motion profile. Called by turnToHeading and turnToPoint once the motion has
+         * started
+         */
+        void turnToHeadingProfiled(float theta, int timeout, TurnToHeadingParams params);
+        /**
+         * @brief Swing to a heading with a motion profile. Called by swingToHeading and swingToPoint once the motion
+         * has started
+         */
+        void swingToHeadingProfiled(float theta, DriveSide lockedSide, int timeout, SwingToHeadingParams params);
+        /**
+         * @brief Convert motor power to the voltage sent to the motors, compensated for the battery voltage if enabled
+         *
+         * @param power motor power, from -127 to 127
+         * @return float voltage command, in millivolts
+         */
+        float powerToVoltage(float power);
+        /**
+         * @brief Take power away from the axis with the lower priority, so lateral and angular power together don't
+         * exceed the maximum. Called by setDriveOutput, and by motions that clamp the lateral power after it
+         *
+         * @param lateral lateral power. Positive drives forwards
+         * @param angular angular power. Positive turns clockwise
+         * @param maxSpeed maximum power of either side
+         * @param desaturation which axis has priority, unless the output settings override it. PROPORTIONAL leaves
+         * both unchanged
+         */
+        void desaturate(float& lateral, float& angular, float maxSpeed, Desaturation desaturation) const;
+        /**
+         * @brief Combine lateral and angular power, and send it to the drivetrain
+         *
+         * @param lateral lateral power. Positive drives forwards
+         * @param angular angular power. Positive turns clockwise
+         * @param maxSpeed maximum power of either side. 127 by default
+         * @param desaturation how to combine the powers if they exceed the maximum, unless the output settings
+         * override it. PROPORTIONAL by default
+         * @return std::pair<float, float> the left and right power
+         */
+        std::pair<float, float> setDriveOutput(float lateral, float angular, float maxSpeed = 127,
+                                               Desaturation desaturation = Desaturation::PROPORTIONAL);
+        /**
+         * @brief Send motor power to both sides of the drivetrain. All motions move the drivetrain through this
+         *
+         * Applies the slew and jerk limits, deadband compensation, and voltage compensation
+         *
+         * @param leftPower power of the left side, from -127 to 127
+         * @param rightPower power of the right side, from -127 to 127
+         * @param immediate whether to skip the slew and jerk limits and always send the voltage, e.g to stop. false by
+         * default
+         */
+        void setDrivePower(float leftPower, float rightPower, bool immediate = false);
+        /**
+         * @brief Forget the voltage last sent to the motors. Called when the motors are commanded some other way
+         */
+        void invalidateDriveOutput();
+        /**
+         * @brief Apply heading hold to the output of driver control
+         *
+         * @param throttle throttle input, after the drive curve
+         * @param turn turn input, after the drive curve
+         * @param angular angular power the driver control scheme would use
+         * @return float the angular power to use
+         */
+        float holdHeading(float throttle, float turn, float angular);
 
         bool motionRunning = false;
         bool motionQueued = false;
 
         float distTraveled = 0;
+        // index of the last waypoint passed by moveThrough
+        int waypointIndex = -1;
+
+        float maxSlip = 0;
+        float tractionMaxChange = 127;
+
+        ProfileSettings lateralProfile;
+        ProfileSettings angularProfile;
+        MPCSettings mpcSettings;
+
+        bool voltageCompensation = false;
+        float nominalVoltage = 12;
+        // filtered battery voltage, in millivolts. 0 if it hasn't been measured yet
+        float batteryVoltage = 0;
+        // when the battery voltage was last filtered
+        std::uint32_t batteryTime = 0;
+
+        OutputSettings outputSettings;
+        // power after the slew and jerk limits, and its rate of change per 10ms
+        float leftOutput = 0;
+        float rightOutput = 0;
+        float leftRate = 0;
+        float rightRate = 0;
+        std::uint32_t lastOutputTime = 0;
+        // voltage last sent to each side, and when
+        float leftVoltage = NAN;
+        float rightVoltage = NAN;
+        std::uint32_t leftWriteTime = 0;
+        std::uint32_t rightWriteTime = 0;
+
+        bool headingHold = false;
+        HeadingHoldSettings headingHoldSettings;
+        PID headingHoldPID = PID(0, 0, 0);
+        // locked heading. NAN if the heading isn't locked
+        float heldHeading = NAN;
+        // last correction, which fades out when the hold is released
+        float holdCorrection = 0;
+        // when the driver stopped turning, when the hold was released, and when heading hold last ran
+        std::uint32_t stillSince = 0;
+        std::uint32_t releaseStart = 0;
+        std::uint32_t lastHoldTime = 0;
+
+        StallSettings stallSettings;
+        bool stalled = false;
+        std::uint32_t motionStartTime = 0;
+        std::uint32_t stallStartTime = 0; // 0 if the robot isn't stalled
+        std::uint32_t impactTime = 0; // last time the IMU measured an impact
+        float stallLeftPower = 0;
+        float stallRightPower = 0;
+
+        AutotuneResult lateralTuneResult;
+        AutotuneResult angularTuneResult;
+        DriveCalibration driveCalibration;
+
+        CalibrationStatus calibrationStatus = CalibrationStatus::NOT_STARTED;
+        pros::Task* calibrationTask = nullptr;
+        // protects the IMUs in sensors, which the calibration task changes while motions read them
+        pros::Mutex sensorMutex;
 
         ControllerSettings lateralSettings;
         ControllerSettings angularSettings;
@@ -4,13 +4,37 @@
 #include "lemlib/pose.hpp"
 
 namespace lemlib {
+/**
+ * @brief Slip of each side of the drivetrain
+ *
+ * Slip ratios are the difference between the speed of the wheels and the speed they move over the ground, divided by
+ * the larger of the two. Positive values mean the wheels are spinning faster than the robot is moving (wheelspin),
+ * negative values mean they're spinning slower (skidding, or being pushed). 0 means no slip
+ */
+struct WheelSlip {
+        /** slip ratio of the left side of the drivetrain */
+        float left = 0;
+        /** slip ratio of the right side of the drivetrain */
+        float right = 0;
+};
+
 /**
  * @brief Set the sensors to be used for odometry
  *
  * @param sensors the sensors to be used
  * @param drivetrain drivetrain to be used
+ * @param settings settings for the odometry task
+ */
+void setSensors(lemlib::OdomSensors sensors, lemlib::Drivetrain drivetrain, lemlib::OdomSettings settings = {});
+/**
+ * @brief Set the IMUs to be used for odometry
+ *
+ * Odometry switches to the new IMUs at the start of its next update, so this can be called while odometry is running,
+ * e.g once the IMUs have finished calibrating
+ *
+ * @param imus the IMUs to be used
  */
-void setSensors(lemlib::OdomSensors sensors, lemlib::Drivetrain drivetrain);
+void setImus(std::vector<pros::Imu*> imus);
 /**
  * @brief Get the pose of the robot
  *
@@ -39,6 +63,15 @@ Pose getSpeed(bool radians = false);
  * @return lemlib::Pose
  */
 Pose getLocalSpeed(bool radians = false);
+/**
+ * @brief Get the estimated slip of each side of the drivetrain
+ *
+ * The drivetrain motor encoders are compared against the tracking wheels every odometry update. If there are no
+ * unpowered tracking wheels, the IMU's acceleration is used instead, which only detects slip while accelerating
+ *
+ * @return WheelSlip
+ */
+WheelSlip getSlip();
 /**
  * @brief Estimate the pose of the robot after a certain amount of time
  *
@@ -47,6 +80,12 @@ Pose getLocalSpeed(bool radians = false);
  * @return lemlib::Pose
  */
 Pose estimatePose(float time, bool radians = false);
+/**
+ * @brief Get how often odometry updates
+ *
+ * @return std::uint32_t update period in milliseconds
+ */
+std::uint32_t getRate();
 /**
  * @brief Update the pose of the robot
  *
@@ -55,6 +94,7 @@ void update();
 /**
  * @brief Initialize the odometry system
  *
+ * Sets the data rate of the IMU and rotation sensors to match the odometry rate, then starts the tracking task
  */
 void init();
 } // namespace lemlib
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include "pros/motors.hpp"
 #include "pros/motor_group.hpp"
 #include "pros/adi.hpp"
@@ -138,7 +139,8 @@ class TrackingWheel {
         /**
          * @brief Get the distance traveled by the tracking wheel
          *
-         * @return float distance traveled in inches
+         * @return float distance traveled in inches. NaN if the sensor returned an error. Disconnected motors in a
+         * motor group are ignored
          *
          * @b Example
          * @code {.cpp}
@@ -151,6 +153,45 @@ class TrackingWheel {
          * }
          */
         float getDistanceTraveled();
+        /**
+         * @brief Get the linear velocity of the tracking wheel
+         *
+         * Rotation sensors and motors report velocity directly. Optical shaft encoders don't, so their velocity is
+         * calculated from the change in position over at least 10ms. Calls less than 10ms apart return the same
+         * velocity, so every caller gets the same measurement
+         *
+         * @return float velocity in inches per second. NaN if the sensor returned an error
+         *
+         * @b Example
+         * @code {.cpp}
+         * void initialize() {
+         *     while (true) {
+         *         // print the velocity of the tracking wheel to the terminal
+         *         std::cout << "velocity: " << exampleTrackingWheel.getVelocity() << std::endl;
+         *         pros::delay(10);
+         *     }
+         * }
+         * @endcode
+         */
+        float getVelocity();
+        /**
+         * @brief Set how often the tracking wheel sensor sends new data
+         *
+         * Only rotation sensors support this. Calling this on a tracking wheel that uses an optical shaft encoder or
+         * a motor group does nothing. If you are using odometry provided by LemLib, this will automatically be called
+         * when the chassis is calibrated
+         *
+         * @param rate the data rate in milliseconds. Minimum of 5ms
+         *
+         * @b Example
+         * @code {.cpp}
+         * void initialize() {
+         *     // get new data from the rotation sensor every 5ms
+         *     exampleTrackingWheel.setDataRate(5);
+         * }
+         * @endcode
+         */
+        void setDataRate(std::uint32_t rate);
         /**
          * @brief Get the offset of the tracking wheel from the center of rotation
          *
@@ -192,5 +233,9 @@ class TrackingWheel {
         pros::Rotation* rotation = nullptr;
         pros::MotorGroup* motors = nullptr;
         float gearRatio = 1;
+        // used to calculate the velocity of optical shaft encoders
+        float prevDistance = 0;
+        std::uint32_t prevTime = 0;
+        float velocity = 0;
 };
 } // namespace lemlib
\ No newline at end of file
@@ -1,3 +1,8 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+
 namespace lemlib {
 
 /**
@@ -5,6 +10,9 @@ namespace lemlib {
  *
  * This is an abstract class to enable users to provide their own, custom drive
  * curves for LemLib to use.
+ *
+ * A curve can store its output for every whole input from -127 to 127 in a table. The chassis then looks the output
+ * up instead of calling curve() every time
  */
 class DriveCurve {
     public:
@@ -17,6 +25,43 @@ class DriveCurve {
          * @return float output
          */
         virtual float curve(float input) = 0;
+        /**
+         * @brief Look the output of an input up in the table, or call curve() if the curve doesn't have a table
+         *
+         * Inputs between whole numbers are interpolated, and inputs outside of -127 to 127 are clamped
+         *
+         * @param input the input to process
+         * @return float output
+         *
+         * @b Example
+         * @code {.cpp}
+         * lemlib::ExpoDriveCurve driveCurve(5, 12, 1.132);
+         * std::cout << driveCurve.lookup(127) << std::endl; // outputs 127
+         * @endcode
+         */
+        constexpr float lookup(float input) {
+            if (!tabulated) return curve(input);
+            input = std::clamp(input, -127.0f, 127.0f) + 127;
+            const int index = std::min(int(input), 253);
+            const float t = input - index;
+            return table[index] + (table[index + 1] - table[index]) * t;
+        }
+    protected:
+        /**
+         * @brief Store the output of curve() for every whole input in the table
+         *
+         * Call this at the end of the constructor of a custom curve to speed it up. The output of curve() must only
+         * depend on its input
+         */
+        void tabulate() {
+            for (int input = -127; input <= 127; input++) table[input + 127] = curve(input);
+            tabulated = true;
+        }
+
+        /** output for every whole input from -127 to 127 */
+        std::array<float, 255> table {};
+        /** whether the table has been filled */
+        bool tabulated = false;
 };
 
 /**
@@ -46,7 +91,22 @@ class ExpoDriveCurve : public DriveCurve {
          * lemlib::ExpoDriveCurve driveCurve(5, 12, 1.132);
          * @endcode
          */
-        ExpoDriveCurve(float deadband, float minOutput, float curve);
+        constexpr ExpoDriveCurve(float deadband, float minOutput, float curve)
+            : deadband(deadband),
+              minOutput(minOutput),
+              curveGain(curve) {
+            // i(x) / i(127) simplifies to curve^(x - 127) * g(x) / g(127), so the table only needs whole powers of the
+            // curve gain, and can be filled at compile time
+            double power = 1; // curve^(x - 127)
+            for (int x = 127; x >= 0; x--) {
+                float output = 0;
+                if (x > deadband) output = (127.0 - minOutput) * power * (x - deadband) / (127 - deadband) + minOutput;
+                table[127 + x] = output;
+                table[127 - x] = -output;
+                power /= curveGain;
+            }
+            tabulated = true;
+        }
         /**
          * @brief curve an input
          *
@@ -66,10 +126,45 @@ class ExpoDriveCurve : public DriveCurve {
          * }
          * @endcode
          */
-        float curve(float input);
+        float curve(float input) override;
     private:
         const float deadband = 0;
         const float minOutput = 0;
         const float curveGain = 1;
 };
+
+/**
+ * @brief CustomDriveCurve class. Inherits from the DriveCurve class. This is a drive curve made from any function
+ *
+ * The function is only called when the curve is constructed, to fill the table. If the curve is constexpr or
+ * constinit, the table is filled at compile time
+ */
+class CustomDriveCurve : public DriveCurve {
+    public:
+        /**
+         * @brief Construct a new Custom Drive Curve object
+         *
+         * @param function function that takes an input from -127 to 127, and returns the output
+         *
+         * @b Example
+         * @code {.cpp}
+         * // a cubic drive curve, filled at compile time
+         * constinit lemlib::CustomDriveCurve cubicCurve([](float input) {
+         *     return input * input * input / (127 * 127); // maps 127 to 127
+         * });
+         * @endcode
+         */
+        template <typename Function> constexpr CustomDriveCurve(Function function) {
+            for (int input = -127; input <= 127; input++) table[input + 127] = function(input);
+            tabulated = true;
+        }
+
+        /**
+         * @brief curve an input
+         *
+         * @param input the input to curve
+         * @return float the curved output, interpolated from the table
+         */
+        float curve(float input) override { return lookup(input); }
+};
 } // namespace lemlib
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstdint>
+
 namespace lemlib {
 class ExitCondition {
     public:
@@ -35,6 +39,7 @@ class ExitCondition {
          * @brief update the exit condition
          *
          * @param input the input for the exit condition
+         * @param velocity velocity of the chassis. Only used for settle detection. NaN by default
          * @return true exit condition met
          * @return false exit condition not met
          *
@@ -48,7 +53,32 @@ class ExitCondition {
          * }
          * @endcode
          */
-        bool update(const float input);
+        bool update(const float input, const float velocity = NAN);
+        /**
+         * @brief exit early once the input has settled
+         *
+         * Instead of waiting for the full time in range, the exit condition is met once the input is in range, its
+         * rate of change is small, the chassis velocity is small, and, if a window is set, the recent inputs don't
+         * vary much, all for the settle time
+         *
+         * @param maxRate largest rate of change of the input, per second. 0 disables settle detection
+         * @param maxVelocity largest velocity of the chassis. 0 to not check the velocity
+         * @param settleTime how long the input has to be settled before exiting, in milliseconds
+         * @param window how many recent inputs to check the standard deviation of. At most 16. 0 by default
+         * @param maxDeviation largest standard deviation of the recent inputs. 0 by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // exit if the input is within 1 of the target for 1000ms
+         * ExitCondition ec(1, 1000);
+         * // exit within 1 inch once the error changes by less than 2 inches per second and the chassis moves
+         * // slower than 1 inch per second, for 30ms
+         * ec.setSettle(2, 1, 30);
+         * // update the exit condition with the error and the chassis velocity
+         * ec.update(error, velocity);
+         * @endcode
+         */
+        void setSettle(float maxRate, float maxVelocity, int settleTime, int window = 0, float maxDeviation = 0);
         /**
          * @brief reset the exit condition timer
          *
@@ -64,5 +94,26 @@ class ExitCondition {
         const int time;
         int startTime = -1;
         bool done = false;
+
+        /**
+         * @brief update settle detection
+         *
+         * @return whether the input has been settled for the settle time
+         */
+        bool updateSettle(float input, float velocity, int curTime);
+
+        // settle detection
+        static constexpr int MAX_WINDOW = 16;
+        float maxRate = 0;
+        float maxVelocity = 0;
+        int settleTime = 0;
+        int window = 0;
+        float maxDeviation = 0;
+        int settleStartTime = -1;
+        float prevInput = 0;
+        std::uint32_t prevInputTime = 0; // in microseconds
+        std::array<float, MAX_WINDOW> history; // ring buffer of recent inputs
+        int historyIndex = 0;
+        int historyCount = 0;
 };
 } // namespace lemlib
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+namespace lemlib {
+/**
+ * @brief State of a motion profile at a point in time
+ */
+struct ProfileState {
+        /** time since the start of the profile, in seconds */
+        float time = 0;
+        /** distance since the start of the profile */
+        float position = 0;
+        /** velocity, in distance per second */
+        float velocity = 0;
+        /** acceleration, in distance per second squared */
+        float acceleration = 0;
+        /** jerk, in distance per second cubed */
+        float jerk = 0;
+};
+
+/**
+ * @brief Motion profile
+ *
+ * Plans the fastest way to move a distance without exceeding a maximum velocity, acceleration and jerk. With no jerk
+ * limit this is a trapezoidal profile. With a jerk limit the acceleration ramps up and down smoothly (an S-curve),
+ * which stops the robot from jerking and the wheels from slipping when the acceleration changes. Jerk limited
+ * profiles are planned in 10ms steps, each taking the most jerk the robot can still stop in time from, so the jerk
+ * limit holds everywhere, including where the robot stops accelerating and starts decelerating. The acceleration
+ * ramps over at least 4 steps, so a larger jerk limit is lowered to that.
+ *
+ * The profile can start and end at a non-zero velocity, so it can be planned while the robot is already moving and
+ * chained into the next motion. If the robot starts moving backwards, the profile stops it first, so the position
+ * goes negative at the start. A jerk limited profile assumes the robot isn't accelerating at the start
+ */
+class MotionProfile {
+    public:
+        /**
+         * @brief Plan a new motion profile
+         *
+         * @param distance distance to move. Must be positive
+         * @param maxVelocity maximum velocity
+         * @param maxAcceleration maximum acceleration
+         * @param maxJerk maximum jerk. 0 for no limit, which makes a trapezoidal profile. 0 by default
+         * @param startVelocity velocity at the start of the profile, which can be negative. 0 by default
+         * @param endVelocity velocity at the end of the profile. 0 by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // move 48 inches at up to 60 inches per second, accelerating at up to 120 inches per second squared,
+         * // with a jerk of up to 600 inches per second cubed
+         * lemlib::MotionProfile profile(48, 60, 120, 600);
+         * // where the robot should be after half a second
+         * lemlib::ProfileState state = profile.sample(0.5);
+         * @endcode
+         */
+        MotionProfile(float distance, float maxVelocity, float maxAcceleration, float maxJerk = 0,
+                      float startVelocity = 0, float endVelocity = 0);
+        /**
+         * @brief Plan a new motion profile where the maximum velocity changes along the way
+         *
+         * This is useful for paths, where the robot has to slow down around tight corners
+         *
+         * @param distance distance to move. Must be positive
+         * @param maxVelocities maximum velocities, evenly spaced from the start to the end. Velocities in between are
+         * interpolated
+         * @param maxAcceleration maximum acceleration
+         * @param maxJerk maximum jerk. 0 for no limit. 0 by default
+         * @param startVelocity velocity at the start of the profile, which can be negative. 0 by default
+         * @param endVelocity velocity at the end of the profile. 0 by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // move 48 inches, slowing down to 20 inches per second halfway through
+         * lemlib::MotionProfile profile(48, {60, 20, 60}, 120);
+         * @endcode
+         */
+        MotionProfile(float distance, const std::vector<float>& maxVelocities, float maxAcceleration,
+                      float maxJerk = 0, float startVelocity = 0, float endVelocity = 0);
+        /**
+         * @brief Get the state of the profile at a point in time
+         *
+         * @param time time since the start of the profile, in seconds
+         * @return ProfileState the state. The end of the profile if the time is past the end
+         */
+        ProfileState sample(float time) const;
+        /**
+         * @brief Get how long the profile takes
+         *
+         * @return float duration in seconds
+         */
+        float getDuration() const;
+    private:
+        std::vector<ProfileState> states;
+};
+} // namespace lemlib
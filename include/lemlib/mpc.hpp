@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include "lemlib/pose.hpp"
+
+namespace lemlib {
+/**
+ * @brief Settings for the model predictive controller
+ *
+ * The solve time grows with the square of the horizon, and linearly with the iterations. bench/mpc.cpp measures the
+ * worst case, with every sweep forced. On a desktop computer with the optimization level PROS uses, the slowest update
+ * with 20 iterations took 15us at a horizon of 10 and 68us at a horizon of 20. The V5 brain hasn't been measured. If
+ * it's around 15 times slower, which is only an estimate, the slowest update at a horizon of 20 takes about 1ms of the
+ * 10ms motion loop
+ */
+struct MPCSettings {
+        /** how many steps the controller looks ahead. Between 1 and 20. 10 by default */
+        int horizon = 10;
+        /** time between steps, in seconds. 0.05 by default */
+        float timeStep = 0.05;
+        /** cost of being ahead of or behind the reference, per inch squared. 1 by default */
+        float alongWeight = 1;
+        /** cost of being to the side of the reference, per inch squared. 4 by default */
+        float crossWeight = 4;
+        /** cost of heading error, per radian squared. 10 by default */
+        float headingWeight = 10;
+        /** cost of changing the wheel velocities from the reference, per (inch per second) squared. 0.01 by default */
+        float velocityWeight = 0.01;
+        /** maximum sweeps of the solver. Limits the worst case solve time. 20 by default */
+        int iterations = 20;
+        /** the solver stops before the maximum sweeps once no wheel velocity changes by more than this in a sweep, in
+         * inches per second. 0 always runs every sweep. 0.001 by default */
+        float tolerance = 0.001;
+};
+
+/**
+ * @brief A step of the reference trajectory the controller tracks
+ */
+struct MPCReference {
+        /** velocity, in inches per second. Negative when driving backwards */
+        float velocity;
+        /** curvature, in 1/inches. Positive curves to the right */
+        float curvature;
+};
+
+/**
+ * @brief Wheel velocities calculated by the model predictive controller, in inches per second
+ */
+struct MPCOutput {
+        float left;
+        float right;
+};
+
+/**
+ * @brief Model predictive controller for differential drive trajectory tracking
+ *
+ * Unlike PID or pure pursuit, the controller plans ahead. It predicts how the error to a reference trajectory evolves
+ * over a short horizon with a unicycle model linearized about the reference, and picks the wheel velocities that keep
+ * it small without exceeding the maximum wheel velocity. This lets it anticipate upcoming curvature, and stay on the
+ * path when the drivetrain is close to saturating.
+ *
+ * The problem is condensed into a small quadratic program over the wheel velocities, which is solved with a fixed
+ * number of projected Gauss-Seidel sweeps so the solve time is bounded. All memory is allocated when the controller is
+ * constructed.
+ */
+class MPC {
+    public:
+        /**
+         * @brief Construct a new model predictive controller
+         *
+         * @param trackWidth track width of the drivetrain, in inches
+         * @param settings the controller settings
+         *
+         * @b Example
+         * @code {.cpp}
+         * // controller for a drivetrain with a track width of 10 inches, looking 0.6 seconds ahead
+         * lemlib::MPC mpc(10, {.horizon = 12, .timeStep = 0.05});
+         * @endcode
+         */
+        MPC(float trackWidth, MPCSettings settings = {});
+        /**
+         * @brief Calculate the wheel velocities that track a reference trajectory
+         *
+         * @param pose current pose of the robot. Heading in radians
+         * @param reference pose the robot should be at now. Heading in radians
+         * @param trajectory velocity and curvature of the reference at every step of the horizon, starting now. The
+         * last step is repeated if there are fewer steps than the horizon
+         * @param maxVelocity maximum wheel velocity, in inches per second
+         * @return MPCOutput the wheel velocities to command now
+         *
+         * @b Example
+         * @code {.cpp}
+         * // track a reference driving straight at 30 inches per second
+         * std::vector<lemlib::MPCReference> trajectory(10, {30, 0});
+         * lemlib::MPCOutput output = mpc.update(chassis.getPose(true), referencePose, trajectory, 60);
+         * @endcode
+         */
+        MPCOutput update(const Pose& pose, const Pose& reference, const std::vector<MPCReference>& trajectory,
+                         float maxVelocity);
+        /**
+         * @brief Forget the previous solution, which is used to warm start the solver
+         */
+        void reset();
+    private:
+        static constexpr int MAX_HORIZON = 20;
+        float trackWidth;
+        MPCSettings settings;
+        // condensed prediction matrix, mapping the wheel velocities to the predicted errors
+        std::vector<float> prediction;
+        // errors predicted with the reference wheel velocities
+        std::vector<float> freeResponse;
+        // quadratic program: hessian, gradient and bounds
+        std::vector<float> hessian;
+        std::vector<float> gradient;
+        std::vector<float> lower;
+        std::vector<float> upper;
+        // wheel velocity changes from the reference, for every step
+        std::vector<float> solution;
+};
+} // namespace lemlib
@@ -1,11 +1,75 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+#include <array>
+#include <vector>
+
 namespace lemlib {
+/**
+ * @brief A set of PID gains, and the error magnitude they apply at
+ */
+struct GainPoint {
+        /** magnitude of the error these gains apply at */
+        float error;
+        float kP;
+        float kI;
+        float kD;
+};
+
+/**
+ * @brief Gain schedule
+ *
+ * PID gains that change with the magnitude of the error, so small corrections and large motions can both be tuned
+ * aggressively. Gains are linearly interpolated between the points, and the gains of the first or last point are
+ * used outside of them. The schedule is resampled into a fixed size table, so looking up the gains takes the same
+ * time no matter how many points there are
+ */
+class GainSchedule {
+    public:
+        /**
+         * @brief Construct a new gain schedule
+         *
+         * @param points gains at different error magnitudes. They don't have to be sorted. An empty schedule is
+         * disabled
+         *
+         * @b Example
+         * @code {.cpp}
+         * // aggressive gains for small turns, gentler gains for large turns
+         * lemlib::GainSchedule schedule({
+         *     {5, 4, 0, 20}, // below 5 degrees of error: kP = 4, kI = 0, kD = 20
+         *     {45, 2.5, 0, 15}, // at 45 degrees of error: kP = 2.5, kI = 0, kD = 15
+         *     {180, 2, 0, 12} // above 180 degrees of error: kP = 2, kI = 0, kD = 12
+         * });
+         * @endcode
+         */
+        GainSchedule(std::vector<GainPoint> points = {});
+        /**
+         * @brief Get the gains at an error
+         *
+         * @param error the error. Only its magnitude is used
+         * @return GainPoint the interpolated gains
+         */
+        GainPoint lookup(float error) const;
+        /**
+         * @return whether the schedule has any points
+         */
+        bool isEnabled() const;
+    private:
+        static constexpr int SIZE = 64;
+        std::array<GainPoint, SIZE + 1> table;
+        float step = 0; // error between entries in the table
+        bool enabled = false;
+};
+
 class PID {
     public:
         /**
          * @brief Construct a new PID
          *
+         * The PID measures the time between updates, and the gains are scaled so they behave the same as if the PID
+         * was updated every 10ms, no matter how often it's actually updated
+         *
          * @param kP proportional gain
          * @param kI integral gain
          * @param kD derivative gain
@@ -28,6 +92,9 @@ class PID {
          * @brief Update the PID
          *
          * @param error target minus position - AKA error
+         * @param dt time since the last update, in seconds. Measured automatically if set to 0. 0 by default
+         * @param measurement the position. Only used if derivative on measurement is enabled. NaN by default
+         * @param feedforward value added to the output before it's limited. 0 by default
          * @return float output
          *
          * @b Example
@@ -38,10 +105,12 @@ class PID {
          *     // give the pid a test input
          *     // the pid will then return an output
          *     float output = pid.update(10);
+         *     // update the pid with a known time step of 10ms
+         *     output = pid.update(10, 0.01);
          * }
          * @endcode
          */
-        float update(float error);
+        float update(float error, float dt = 0, float measurement = NAN, float feedforward = 0);
 
         /**
          * @brief reset integral, derivative, and prevTime
@@ -60,17 +129,121 @@ class PID {
          * @endcode
          */
         void reset();
+
+        /**
+         * @brief Low pass filter the derivative
+         *
+         * The derivative amplifies sensor noise. A first order low pass filter smooths it, at the cost of some lag
+         *
+         * @param timeConstant time constant of the filter, in seconds. 0 disables the filter
+         *
+         * @b Example
+         * @code {.cpp}
+         * PID pid(5, 0, 20);
+         * // filter the derivative with a time constant of 20ms
+         * pid.setDerivativeFilter(0.02);
+         * @endcode
+         */
+        void setDerivativeFilter(float timeConstant);
+
+        /**
+         * @brief Calculate the derivative from the measurement instead of the error
+         *
+         * When the target changes suddenly, so does the error, which makes the derivative spike. Using the rate of
+         * change of the measurement instead avoids this. Only applies to updates that pass a measurement
+         *
+         * @param enabled whether to use derivative on measurement
+         *
+         * @b Example
+         * @code {.cpp}
+         * PID pid(5, 0, 20);
+         * pid.setDerivativeOnMeasurement(true);
+         * // the measurement is passed after the time step
+         * float output = pid.update(target - position, 0, position);
+         * @endcode
+         */
+        void setDerivativeOnMeasurement(bool enabled);
+
+        /**
+         * @brief Limit the output of the PID
+         *
+         * The integral stops growing while the output is limited, so it doesn't wind up
+         *
+         * @param limit largest magnitude of the output. 0 for no limit
+         *
+         * @b Example
+         * @code {.cpp}
+         * PID pid(5, 0, 20);
+         * // limit the output to the range of a motor
+         * pid.setOutputLimit(127);
+         * @endcode
+         */
+        void setOutputLimit(float limit);
+
+        /**
+         * @brief Schedule the gains of the PID by the magnitude of the error
+         *
+         * While a schedule is set, its gains are used instead of the gains passed to the constructor. Set an empty
+         * schedule to go back to the constructor gains
+         *
+         * @param schedule the gain schedule
+         *
+         * @b Example
+         * @code {.cpp}
+         * // use gentler gains for large turns
+         * chassis.angularPID.setGainSchedule({{
+         *     {5, 4, 0, 20}, // small turns
+         *     {90, 2, 0, 10} // large turns
+         * }});
+         * // go back to the gains in the controller settings
+         * chassis.angularPID.setGainSchedule({});
+         * @endcode
+         */
+        void setGainSchedule(GainSchedule schedule);
+
+        /**
+         * @brief Get the gain schedule of the PID
+         *
+         * @return const GainSchedule& the gain schedule. It's disabled if no schedule is set
+         */
+        const GainSchedule& getGainSchedule() const;
+
+        /**
+         * @brief Set the gains of the PID
+         *
+         * The integral and derivative aren't reset. If a gain schedule is set, it's still used instead of these gains
+         *
+         * @param kP proportional gain
+         * @param kI integral gain
+         * @param kD derivative gain
+         *
+         * @b Example
+         * @code {.cpp}
+         * PID pid(5, 0, 20);
+         * // use more aggressive gains
+         * pid.setGains(8, 0, 30);
+         * @endcode
+         */
+        void setGains(float kP, float kI, float kD);
     protected:
         // gains
-        const float kP;
-        const float kI;
-        const float kD;
+        float kP;
+        float kI;
+        float kD;
 
         // optimizations
         const float windupRange;
         const bool signFlipReset;
 
+        float derivativeFilter = 0;
+        bool derivativeOnMeasurement = false;
+        float outputLimit = 0;
+        GainSchedule schedule;
+
         float integral = 0;
         float prevError = 0;
+        float prevMeasurement = NAN;
+        float derivative = 0;
+        std::uint32_t prevTime = 0;
 };
-} // namespace lemlib
\ No newline at end of file
+} // namespace lemlib
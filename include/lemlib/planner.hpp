@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "pros/rtos.hpp"
+#include "lemlib/chassis/chassis.hpp"
+
+namespace lemlib {
+/**
+ * @brief Occupancy grid of the field
+ *
+ * The field is split into square cells, each of which is either free or occupied. Every cell is stored as a single
+ * bit, so a 144" x 144" field at 1" resolution fits in under 3KB and can be copied cheaply, e.g to add dynamic
+ * obstacles to a static field map. The grid is centered on the origin, like the field.
+ */
+class OccupancyGrid {
+    public:
+        /**
+         * @brief Construct a new, empty occupancy grid
+         *
+         * @param width width of the grid, in inches. 144 by default
+         * @param height height of the grid, in inches. 144 by default
+         * @param resolution size of a cell, in inches. 1 by default
+         *
+         * @b Example
+         * @code {.cpp}
+         * // the whole field at 1 inch resolution
+         * lemlib::OccupancyGrid field;
+         * // a goal in the middle of the field
+         * field.addCircle(0, 0, 5);
+         * // a barrier along the middle of the field
+         * field.addRectangle(-24, -1, 24, 1);
+         * @endcode
+         */
+        OccupancyGrid(float width = 144, float height = 144, float resolution = 1);
+        /**
+         * @brief Mark a rectangle as occupied
+         *
+         * @param x1 x position of a corner
+         * @param y1 y position of a corner
+         * @param x2 x position of the opposite corner
+         * @param y2 y position of the opposite corner
+         */
+        void addRectangle(float x1, float y1, float x2, float y2);
+        /**
+         * @brief Mark a circle as occupied
+         *
+         * @param x x position of the center
+         * @param y y position of the center
+         * @param radius radius of the circle
+         */
+        void addCircle(float x, float y, float radius);
+        /**
+         * @brief Mark every cell as free
+         */
+        void clear();
+        /**
+         * @brief Check whether a point is occupied. Points outside of the grid are occupied
+         *
+         * @param x x position
+         * @param y y position
+         * @return true the point is occupied
+         */
+        bool isOccupied(float x, float y) const;
+        /**
+         * @brief Grow every obstacle by a radius, e.g the radius of the robot
+         *
+         * @param radius how far to grow the obstacles, in inches
+         * @return OccupancyGrid a copy of the grid with the grown obstacles
+         */
+        OccupancyGrid inflate(float radius) const;
+
+        int getColumns() const;
+        int getRows() const;
+        float getResolution() const;
+        /**
+         * @brief Check whether a cell is occupied. Cells outside of the grid are occupied
+         */
+        bool isOccupied(int column, int row) const;
+        /**
+         * @brief Get the cell a point is in
+         */
+        void toCell(float x, float y, int& column, int& row) const;
+        /**
+         * @brief Get the point in the center of a cell
+         */
+        void toPoint(int column, int row, float& x, float& y) const;
+    private:
+        /**
+         * @brief Mark cells in a row as occupied, from the first column to the last one inclusive
+         */
+        void setSpan(int row, int first, int last);
+
+        int columns;
+        int rows;
+        // 64 bit words in each row
+        int words;
+        float resolution;
+        std::vector<std::uint64_t> cells;
+};
+
+/**
+ * @brief Settings for the path planner
+ *
+ * Planning on a 144" x 144" field at 1" resolution takes at most about 6ms on a desktop computer with the optimization
+ * level PROS uses, measured with bench/planner.cpp. The slowest cases are long paths around many obstacles, and goals
+ * that can't be reached but aren't sealed in a small pocket. The V5 brain is expected to be around 15 times slower
+ */
+struct PlannerSettings {
+        /** distance from the center of the robot to its furthest point, in inches. Obstacles are grown by this much.
+         * 9 by default */
+        float robotRadius = 9;
+        /** longest time the planner can spend searching, in milliseconds. Large enough for the slowest measured case
+         * on a V5 brain. 100 by default */
+        int timeBudget = 100;
+};
+
+/**
+ * @brief Enum class PlanStatus
+ */
+enum class PlanStatus { IDLE, PLANNING, FOUND, NO_PATH, TIMED_OUT };
+
+/**
+ * @brief Path planner
+ *
+ * Finds the shortest path between two points on an occupancy grid with Theta*, a variant of A* that isn't restricted
+ * to the directions between neighbouring cells. The path is shortened further by removing every point the robot can
+ * skip without hitting an obstacle, so it is made of a few straight lines between obstacle corners. It can be
+ * followed directly by Chassis::moveThrough.
+ *
+ * The robot is kept away from obstacles by its radius. If the robot starts too close to an obstacle, e.g against a
+ * wall, it is allowed to move away from it. Goals sealed off in a small pocket, or with the robot sealed in one, are
+ * found to be unreachable without searching.
+ */
+class PathPlanner {
+    public:
+        /**
+         * @brief Construct a new path planner
+         *
+         * @param settings the planner settings
+         */
+        PathPlanner(PlannerSettings settings = {});
+        /**
+         * @brief Plan a path, and wait for it
+         *
+         * @param grid the field, with the obstacles at their actual size
+         * @param x x position to start from
+         * @param y y position to start from
+         * @param goal point to go to. Its heading is kept for the end of the path
+         * @return std::vector<Waypoint> the points to move through, not including the start. Empty if no path was
+         * found
+         *
+         * @b Example
+         * @code {.cpp}
+         * lemlib::PathPlanner planner({.robotRadius = 9, .timeBudget = 100});
+         * // plan a path from the robot to (48, 48)
+         * const lemlib::Pose pose = chassis.getPose();
+         * std::vector<lemlib::Waypoint> path = planner.plan(field, pose.x, pose.y, {48, 48});
+         * // follow it
+         * if (!path.empty()) chassis.moveThrough(path, 4000);
+         * @endcode
+         */
+        std::vector<Waypoint> plan(const OccupancyGrid& grid, float x, float y, Waypoint goal);
+        /**
+         * @brief Plan a path in a background task
+         *
+         * The planner has to exist until the task has finished
+         *
+         * @param grid the field, with the obstacles at their actual size. It is copied
+         * @param x x position to start from
+         * @param y y position to start from
+         * @param goal point to go to. Its heading is kept for the end of the path
+         *
+         * @b Example
+         * @code {.cpp}
+         * // plan the next path while the robot is still moving
+         * planner.planAsync(field, 48, 48, {-24, 0});
+         * chassis.moveToPoint(48, 48, 2000);
+         * chassis.waitUntilDone();
+         * planner.waitUntilDone();
+         * if (planner.getStatus() == lemlib::PlanStatus::FOUND) chassis.moveThrough(planner.getPath(), 4000);
+         * @endcode
+         */
+        void planAsync(const OccupancyGrid& grid, float x, float y, Waypoint goal);
+        /**
+         * @brief Get the status of the last plan
+         */
+        PlanStatus getStatus();
+        /**
+         * @brief Get the path of the last plan. Empty if no path was found
+         */
+        std::vector<Waypoint> getPath();
+        /**
+         * @brief Wait until the planner isn't planning anymore
+         */
+        void waitUntilDone();
+    private:
+        PlannerSettings settings;
+        PlanStatus status = PlanStatus::IDLE;
+        std::vector<Waypoint> path;
+        pros::Mutex mutex;
+};
+} // namespace lemlib
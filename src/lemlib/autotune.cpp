@@ -0,0 +1,85 @@
+#include <algorithm>
+#include "lemlib/autotune.hpp"
+
+namespace lemlib {
+// the chassis PIDs are tuned as if they were updated this often, in seconds
+constexpr float PID_DT = 0.01;
+
+RelayExperiment::RelayExperiment(const AutotuneParams& params)
+    : params(params),
+      relay(params.relayOutput) {}
+
+float RelayExperiment::update(float position, float time) {
+    max = std::max(max, position);
+    min = std::min(min, position);
+    if (relay < 0 && position < -params.hysteresis) {
+        relay = params.relayOutput;
+        // the first full cycle is skipped, since the oscillation isn't steady yet
+        if (++cycles >= 3) {
+            periodSum += time - cycleStart;
+            amplitudeSum += (max - min) / 2;
+            measured++;
+        }
+        cycleStart = time;
+        max = -INFINITY;
+        min = INFINITY;
+    } else if (relay > 0 && position > params.hysteresis) {
+        relay = -params.relayOutput;
+    }
+    return relay;
+}
+
+bool RelayExperiment::isDone() const { return measured >= params.cycles; }
+
+AutotuneResult RelayExperiment::getResult() const {
+    AutotuneResult result;
+    // calculate the ultimate gain and period
+    result.amplitude = measured != 0 ? amplitudeSum / measured : 0;
+    const float amplitude = result.amplitude;
+    if (!isDone() || amplitude <= params.hysteresis) return result;
+    result.success = true;
+    result.tu = periodSum / measured;
+    result.ku =
+        4 * params.relayOutput / (M_PI * std::sqrt(amplitude * amplitude - params.hysteresis * params.hysteresis));
+
+    // calculate the gains. Integral and derivative times are converted to the per-update gains the PID uses
+    // gain, integral time, and derivative time multipliers of each rule
+    float kpRatio = 0.2;
+    float tiRatio = 0.5;
+    float tdRatio = 1.0 / 3;
+    if (params.rule == TuningRule::ZIEGLER_NICHOLS) {
+        kpRatio = 0.6;
+        tdRatio = 1.0 / 8;
+    } else if (params.rule == TuningRule::SOME_OVERSHOOT) {
+        kpRatio = 0.33;
+    } else if (params.rule == TuningRule::TYREUS_LUYBEN) {
+        kpRatio = 0.45;
+        tiRatio = 2.2;
+        tdRatio = 1 / 6.3;
+    }
+    const float kp = kpRatio * result.ku;
+    const float ti = tiRatio * result.tu;
+    const float td = tdRatio * result.tu;
+    result.kP = kp;
+    result.kI = params.integral ? kp * PID_DT / ti : 0;
+    result.kD = kp * td / PID_DT;
+    return result;
+}
+
+StepResponse::StepResponse(float target, float stepSize, float smallError, float time)
+    : target(target),
+      stepSize(stepSize),
+      smallError(smallError),
+      start(time),
+      lastOutside(time) {}
+
+void StepResponse::update(float position, float time) {
+    const float error = target - position;
+    if (std::fabs(error) > smallError) lastOutside = time;
+    overshoot = std::max(overshoot, -error / stepSize);
+}
+
+float StepResponse::getOvershoot() const { return overshoot; }
+
+float StepResponse::getSettlingTime() const { return lastOutside - start; }
+} // namespace lemlib
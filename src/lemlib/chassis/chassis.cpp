@@ -1,5 +1,7 @@
 #include <math.h>
+#include <algorithm>
 #include "pros/imu.hpp"
+#include "pros/misc.hpp"
 #include "pros/motors.h"
 #include "pros/rtos.h"
 #include "lemlib/logger/logger.hpp"
@@ -10,12 +12,29 @@
 #include "pros/rtos.hpp"
 
 lemlib::OdomSensors::OdomSensors(TrackingWheel* vertical1, TrackingWheel* vertical2, TrackingWheel* horizontal1,
-                                 TrackingWheel* horizontal2, pros::Imu* imu)
+                                 TrackingWheel* horizontal2, pros::Imu* imu, pros::Gps* gps)
     : vertical1(vertical1),
       vertical2(vertical2),
       horizontal1(horizontal1),
       horizontal2(horizontal2),
-      imu(imu) {}
+      imu(imu),
+      gps(gps) {
+    if (imu != nullptr) imus.push_back(imu);
+}
+
+lemlib::OdomSensors::OdomSensors(TrackingWheel* vertical1, TrackingWheel* vertical2, TrackingWheel* horizontal1,
+                                 TrackingWheel* horizontal2, std::vector<pros::Imu*> imus, pros::Gps* gps)
+    : vertical1(vertical1),
+      vertical2(vertical2),
+      horizontal1(horizontal1),
+      horizontal2(horizontal2),
+      imu(nullptr),
+      gps(gps) {
+    for (pros::Imu* imu : imus) {
+        if (imu != nullptr) this->imus.push_back(imu);
+    }
+    if (!this->imus.empty()) this->imu = this->imus.front();
+}
 
 lemlib::Drivetrain::Drivetrain(pros::MotorGroup* leftMotors, pros::MotorGroup* rightMotors, float trackWidth,
                                float wheelDiameter, float rpm, float horizontalDrift)
@@ -39,42 +58,80 @@ lemlib::Chassis::Chassis(Drivetrain drivetrain, ControllerSettings linearSetting
       lateralLargeExit(lateralSettings.largeError, lateralSettings.largeErrorTimeout),
       lateralSmallExit(lateralSettings.smallError, lateralSettings.smallErrorTimeout),
       angularLargeExit(angularSettings.largeError, angularSettings.largeErrorTimeout),
-      angularSmallExit(angularSettings.smallError, angularSettings.smallErrorTimeout) {}
+      angularSmallExit(angularSettings.smallError, angularSettings.smallErrorTimeout) {
+    lateralSmallExit.setSettle(lateralSettings.settleRate, lateralSettings.settleVelocity, lateralSettings.settleTime,
+                               lateralSettings.settleWindow, lateralSettings.settleDeviation);
+    angularSmallExit.setSettle(angularSettings.settleRate, angularSettings.settleVelocity, angularSettings.settleTime,
+                               angularSettings.settleWindow, angularSettings.settleDeviation);
+}
 
 /**
- * @brief calibrate the IMU given a sensors struct
+ * @brief calibrate the IMUs given a sensors struct
+ *
+ * All the IMUs are calibrated at the same time. IMUs that fail to calibrate are retried, and removed from the sensors
+ * struct if they still fail after 5 attempts
  *
  * @param sensors reference to the sensors struct
  */
 void calibrateIMU(lemlib::OdomSensors& sensors) {
+    std::vector<pros::Imu*> uncalibrated = sensors.imus;
+    std::vector<pros::Imu*> calibrated;
     int attempt = 1;
-    bool calibrated = false;
     // calibrate inertial, and if calibration fails, then repeat 5 times or until successful
-    while (attempt <= 5) {
-        sensors.imu->reset();
-        // wait until IMU is calibrated
-        do pros::delay(10);
-        while (sensors.imu->get_status() != pros::ImuStatus::error && sensors.imu->is_calibrating());
-        // exit if imu has been calibrated
-        if (!isnanf(sensors.imu->get_heading()) && !isinf(sensors.imu->get_heading())) {
-            calibrated = true;
-            break;
+    while (attempt <= 5 && !uncalibrated.empty()) {
+        for (pros::Imu* imu : uncalibrated) imu->reset();
+        // wait until every IMU is done calibrating
+        bool calibrating = true;
+        while (calibrating) {
+            pros::delay(10);
+            calibrating = false;
+            for (pros::Imu* imu : uncalibrated) {
+                if (imu->get_status() != pros::ImuStatus::error && imu->is_calibrating()) calibrating = true;
+            }
+        }
+        // keep the IMUs that have been calibrated
+        std::vector<pros::Imu*> failed;
+        for (pros::Imu* imu : uncalibrated) {
+            if (!isnanf(imu->get_heading()) && !isinf(imu->get_heading())) calibrated.push_back(imu);
+            else failed.push_back(imu);
         }
+        uncalibrated = failed;
+        if (uncalibrated.empty()) break;
         // indicate error
         pros::c::controller_rumble(pros::E_CONTROLLER_MASTER, "---");
-        lemlib::infoSink()->warn("IMU failed to calibrate! Attempt #{}", attempt);
+        for (pros::Imu* imu : uncalibrated) {
+            lemlib::infoSink()->warn("IMU on port {} failed to calibrate! Attempt #{}", imu->get_port(), attempt);
+        }
         attempt++;
     }
     // check if calibration attempts were successful
-    if (attempt > 5) {
-        sensors.imu = nullptr;
+    for (pros::Imu* imu : uncalibrated) {
+        lemlib::infoSink()->error("IMU on port {} failed to calibrate, ignoring it", imu->get_port());
+    }
+    if (calibrated.empty() && !sensors.imus.empty())
         lemlib::infoSink()->error("IMU calibration failed, defaulting to tracking wheels / motor encoders");
+    // keep the IMUs in the order the user gave them
+    std::vector<pros::Imu*> imus;
+    for (pros::Imu* imu : sensors.imus) {
+        if (std::find(calibrated.begin(), calibrated.end(), imu) != calibrated.end()) imus.push_back(imu);
     }
+    sensors.imus = imus;
+    sensors.imu = imus.empty() ? nullptr : imus.front();
 }
 
-void lemlib::Chassis::calibrate(bool calibrateImu) {
+void lemlib::Chassis::calibrate(bool calibrateImu, OdomSettings odomSettings, bool blocking) {
     // calibrate the IMU if it exists and the user doesn't specify otherwise
-    if (sensors.imu != nullptr && calibrateImu) calibrateIMU(sensors);
+    const bool calibrating =
+        !sensors.imus.empty() && calibrateImu && calibrationStatus != CalibrationStatus::CALIBRATING;
+    if (calibrating) {
+        calibrationStatus = CalibrationStatus::CALIBRATING;
+        if (blocking) {
+            calibrateIMU(sensors);
+            calibrationStatus = sensors.imus.empty() ? CalibrationStatus::FAILED : CalibrationStatus::DONE;
+        }
+    } else if (calibrationStatus != CalibrationStatus::CALIBRATING) {
+        calibrationStatus = CalibrationStatus::DONE;
+    }
     // initialize odom
     if (sensors.vertical1 == nullptr)
         sensors.vertical1 = new lemlib::TrackingWheel(drivetrain.leftMotors, drivetrain.wheelDiameter,
@@ -86,12 +143,44 @@ void lemlib::Chassis::calibrate(bool calibrateImu) {
     sensors.vertical2->reset();
     if (sensors.horizontal1 != nullptr) sensors.horizontal1->reset();
     if (sensors.horizontal2 != nullptr) sensors.horizontal2->reset();
-    setSensors(sensors, drivetrain);
+    // odometry doesn't use the IMUs until they're calibrated
+    sensorMutex.take();
+    OdomSensors odomSensors = sensors;
+    sensorMutex.give();
+    if (calibrationStatus == CalibrationStatus::CALIBRATING) {
+        odomSensors.imus.clear();
+        odomSensors.imu = nullptr;
+    }
+    setSensors(odomSensors, drivetrain, odomSettings);
     init();
+    // calibrate the IMUs in the background, and give them to odometry once they're done
+    if (calibrating && !blocking) {
+        delete calibrationTask;
+        // the IMUs are calibrated in a copy of the sensors, since motions read the sensors while this runs
+        calibrationTask = new pros::Task {[this, calibrated = sensors]() mutable {
+            calibrateIMU(calibrated);
+            setImus(calibrated.imus);
+            sensorMutex.take();
+            sensors.imus = calibrated.imus;
+            sensors.imu = calibrated.imu;
+            sensorMutex.give();
+            calibrationStatus = calibrated.imus.empty() ? CalibrationStatus::FAILED : CalibrationStatus::DONE;
+            pros::c::controller_rumble(pros::E_CONTROLLER_MASTER, ".");
+        }};
+        return;
+    }
     // rumble to controller to indicate success
     pros::c::controller_rumble(pros::E_CONTROLLER_MASTER, ".");
 }
 
+lemlib::CalibrationStatus lemlib::Chassis::getCalibrationStatus() const { return calibrationStatus; }
+
+lemlib::CalibrationStatus lemlib::Chassis::waitUntilCalibrated(std::uint32_t timeout) {
+    const std::uint32_t start = pros::millis();
+    while (calibrationStatus == CalibrationStatus::CALIBRATING && pros::millis() - start < timeout) pros::delay(10);
+    return calibrationStatus;
+}
+
 void lemlib::Chassis::setPose(float x, float y, float theta, bool radians) {
     lemlib::setPose(lemlib::Pose(x, y, theta), radians);
 }
@@ -116,12 +205,24 @@ void lemlib::Chassis::waitUntilDone() {
     while (distTraveled != -1);
 }
 
+void lemlib::Chassis::waitUntilWaypoint(int index) {
+    // do while to give the thread time to start
+    do pros::delay(10);
+    while (waypointIndex < index && distTraveled != -1);
+}
+
 void lemlib::Chassis::requestMotionStart() {
     if (this->isInMotion()) this->motionQueued = true; // indicate a motion is queued
     else this->motionRunning = true; // indicate a motion is running
 
     // wait until this motion is at front of "queue"
     this->mutex.take(TIMEOUT_MAX);
+    // start looking for stalls from scratch
+    stalled = false;
+    motionStartTime = pros::millis();
+    stallStartTime = 0;
+    // traction control starts over, so slip in the last motion doesn't hold back this one
+    tractionMaxChange = 127;
 
     // this->motionRunning should be true
     // and this->motionQueued should be false
@@ -159,3 +260,236 @@ void lemlib::Chassis::setBrakeMode(pros::motor_brake_mode_e mode) {
     drivetrain.leftMotors->set_brake_mode_all(mode);
     drivetrain.rightMotors->set_brake_mode_all(mode);
 }
+
+void lemlib::Chassis::setTractionControl(float maxSlip) { this->maxSlip = std::fabs(maxSlip); }
+
+float lemlib::Chassis::tractionSlew(float target, float current, float maxChange) {
+    if (maxSlip == 0) return slew(target, current, maxChange);
+    // the most the output is allowed to change if the wheels aren't slipping
+    const float limit = maxChange == 0 ? 127 : maxChange;
+    // cut the allowed change quickly when slipping, and grow it back gradually
+    const WheelSlip slip = lemlib::getSlip();
+    if (std::max(std::fabs(slip.left), std::fabs(slip.right)) > maxSlip) tractionMaxChange /= 2;
+    else tractionMaxChange *= 1.25;
+    tractionMaxChange = std::clamp(tractionMaxChange, 0.5f, limit);
+    return slew(target, current, tractionMaxChange);
+}
+
+void lemlib::Chassis::setStallDetection(StallSettings settings) { stallSettings = settings; }
+
+bool lemlib::Chassis::isStalled() const { return stalled; }
+
+/**
+ * @brief Get the average current draw of a motor group
+ *
+ * @param motors the motor group
+ * @return float current draw in milliamps. 0 if it can't be read
+ */
+float averageCurrent(pros::MotorGroup* motors) {
+    const std::vector<std::int32_t> currents = motors->get_current_draw_all();
+    float sum = 0;
+    int count = 0;
+    for (const std::int32_t current : currents) {
+        if (current == PROS_ERR) continue;
+        sum += current;
+        count++;
+    }
+    return count != 0 ? sum / count : 0;
+}
+
+bool lemlib::Chassis::checkStall(float leftPower, float rightPower) {
+    if (stallSettings.action == StallAction::NONE) return false;
+    const std::uint32_t now = pros::millis();
+
+    // an impact is remembered for the stall time, since the robot only slows down after it
+    sensorMutex.take();
+    pros::Imu* imu = sensors.imu;
+    sensorMutex.give();
+    if (stallSettings.impact > 0 && imu != nullptr) {
+        const pros::imu_accel_s_t accel = imu->get_accel();
+        if (std::hypot(accel.x, accel.y) > stallSettings.impact) impactTime = now;
+    }
+    if (now - motionStartTime < std::uint32_t(stallSettings.startupTime)) return false;
+
+    // compare the commanded speed of each side to its speed over the ground
+    const float maxSpeed = drivetrain.rpm * M_PI * drivetrain.wheelDiameter / 60;
+    const Pose speed = getLocalSpeed(true);
+    const float leftSpeed = speed.y + speed.theta * drivetrain.trackWidth / 2;
+    const float rightSpeed = speed.y - speed.theta * drivetrain.trackWidth / 2;
+    auto sideStalled = [&](float power, float actual, pros::MotorGroup* motors) {
+        if (std::fabs(power) < stallSettings.minPower) return false;
+        const float commanded = power / 127 * maxSpeed;
+        // moving much slower than commanded, or in the wrong direction
+        if (actual * sgn(commanded) > std::fabs(commanded) * stallSettings.speedRatio) return false;
+        const bool impact = impactTime != 0 && now - impactTime < std::uint32_t(stallSettings.time);
+        return impact || averageCurrent(motors) > stallSettings.current;
+    };
+    const bool stalledNow = sideStalled(leftPower, leftSpeed, drivetrain.leftMotors) ||
+                            sideStalled(rightPower, rightSpeed, drivetrain.rightMotors);
+
+    if (!stalledNow) {
+        stallStartTime = 0;
+        return false;
+    }
+    if (stallStartTime == 0) stallStartTime = now;
+    if (now - stallStartTime < std::uint32_t(stallSettings.time)) return false;
+    infoSink()->info("Stall detected, ending motion");
+    stalled = true;
+    stallLeftPower = leftPower;
+    stallRightPower = rightPower;
+    return true;
+}
+
+void lemlib::Chassis::applyStallAction() {
+    if (!stalled) return;
+    if (stallSettings.action == StallAction::BACK_OFF) {
+        // drive in the opposite direction to the one each side was pushing in
+        setDrivePower(-sgn(stallLeftPower) * stallSettings.backOffPower,
+                      -sgn(stallRightPower) * stallSettings.backOffPower, true);
+        pros::delay(stallSettings.backOffTime);
+        setDrivePower(0, 0, true);
+    } else if (stallSettings.action == StallAction::HOLD) {
+        // the motors hold zero velocity until they're given a new command
+        drivetrain.leftMotors->move_velocity(0);
+        drivetrain.rightMotors->move_velocity(0);
+        invalidateDriveOutput();
+    }
+}
+
+void lemlib::Chassis::setProfileSettings(Axis axis, ProfileSettings settings) {
+    if (axis == Axis::ANGULAR) angularProfile = settings;
+    else lateralProfile = settings;
+}
+
+void lemlib::Chassis::setMPCSettings(MPCSettings settings) {
+    settings.horizon = std::clamp(settings.horizon, 1, 20);
+    mpcSettings = settings;
+}
+
+void lemlib::Chassis::setVoltageCompensation(bool enabled, float nominalVoltage) {
+    voltageCompensation = enabled;
+    this->nominalVoltage = nominalVoltage;
+}
+
+float lemlib::Chassis::powerToVoltage(float power) {
+    // without compensation, full power is the full voltage command, like move()
+    if (!voltageCompensation) return power / 127 * 12000;
+    // the battery voltage sags under load, so it is filtered to stop the compensation from reacting to its own
+    // current draw. The filter only follows the slow drain of the battery, so its time constant is a few seconds, and
+    // it's updated on elapsed time, so it doesn't change with how often the motors are written to
+    constexpr float BATTERY_TIME_CONSTANT = 2000; // milliseconds
+    const std::uint32_t now = pros::millis();
+    if (batteryVoltage == 0 || now != batteryTime) {
+        const std::int32_t measured = pros::battery::get_voltage();
+        if (measured != PROS_ERR && measured > 0) {
+            const float elapsed = now - batteryTime;
+            batteryVoltage = batteryVoltage == 0
+                                 ? measured
+                                 : ema(measured, batteryVoltage, elapsed / (BATTERY_TIME_CONSTANT + elapsed));
+            batteryTime = now;
+        }
+    }
+    if (batteryVoltage == 0) return power / 127 * 12000;
+    // the voltage command is the fraction of the battery voltage the motors apply
+    const float voltage = power / 127 * nominalVoltage * 1000;
+    return std::clamp(voltage / batteryVoltage * 12000, -12000.0f, 12000.0f);
+}
+
+void lemlib::Chassis::setOutputSettings(OutputSettings settings) { outputSettings = settings; }
+
+void lemlib::Chassis::desaturate(float& lateral, float& angular, float maxSpeed, Desaturation desaturation) const {
+    if (outputSettings.desaturation != Desaturation::AUTO) desaturation = outputSettings.desaturation;
+    const float overturn = std::fabs(lateral) + std::fabs(angular) - maxSpeed;
+    if (overturn > 0 && desaturation == Desaturation::ANGULAR_PRIORITY) {
+        lateral -= sgn(lateral) * std::min(overturn, std::fabs(lateral));
+    } else if (overturn > 0 && desaturation == Desaturation::LATERAL_PRIORITY) {
+        angular -= sgn(angular) * std::min(overturn, std::fabs(angular));
+    }
+}
+
+std::pair<float, float> lemlib::Chassis::setDriveOutput(float lateral, float angular, float maxSpeed,
+                                                        Desaturation desaturation) {
+    // take power away from the axis with the lower priority first
+    desaturate(lateral, angular, maxSpeed, desaturation);
+    // ratio the speeds to respect the max speed
+    float leftPower = lateral + angular;
+    float rightPower = lateral - angular;
+    const float ratio = std::max(std::fabs(leftPower), std::fabs(rightPower)) / maxSpeed;
+    if (ratio > 1) {
+        leftPower /= ratio;
+        rightPower /= ratio;
+    }
+    setDrivePower(leftPower, rightPower);
+    return {leftPower, rightPower};
+}
+
+void lemlib::Chassis::setDrivePower(float leftPower, float rightPower, bool immediate) {
+    const std::uint32_t now = pros::millis();
+    // limit the rate of change of each side. Time is measured in 10ms steps, like the motion loops. The limits start
+    // over if nothing was sent for a while
+    const bool limited = outputSettings.slew > 0 || outputSettings.jerk > 0;
+    if (!immediate && limited && lastOutputTime != 0 && now - lastOutputTime <= 100) {
+        const float steps = std::max(now - lastOutputTime, std::uint32_t(1)) / 10.0;
+        auto limit = [&](float target, float& output, float& rate) {
+            const float change = (target - output) / steps;
+            float newRate = change;
+            if (outputSettings.jerk > 0) {
+                newRate = std::clamp(newRate, rate - outputSettings.jerk * steps, rate + outputSettings.jerk * steps);
+            }
+            if (outputSettings.slew > 0) newRate = std::clamp(newRate, -outputSettings.slew, outputSettings.slew);
+            // don't go past the target
+            newRate = change >= 0 ? std::min(newRate, change) : std::max(newRate, change);
+            rate = newRate;
+            output += rate * steps;
+        };
+        limit(leftPower, leftOutput, leftRate);
+        limit(rightPower, rightOutput, rightRate);
+    } else {
+        leftOutput = leftPower;
+        rightOutput = rightPower;
+        leftRate = 0;
+        rightRate = 0;
+    }
+    lastOutputTime = now;
+
+    // scale non-zero power to start from the deadband, or look up the power the side needs if it's calibrated
+    auto compensate = [&](float power, const std::array<float, 128>& table) {
+        if (std::fabs(power) < 0.01) return 0.0f;
+        const float magnitude = std::min(std::fabs(power), 127.0f);
+        if (driveCalibration.success) {
+            // the table has an entry for every whole power, so the entries either side are found directly
+            const int index = std::min(int(magnitude), 126);
+            const float t = magnitude - index;
+            return sgn(power) * (table[index] * (1 - t) + table[index + 1] * t);
+        }
+        return sgn(power) * (outputSettings.deadband + magnitude * (127 - outputSettings.deadband) / 127);
+    };
+    // only send the voltage if it changed, or it hasn't been sent in a while
+    auto write = [&](pros::MotorGroup* motors, float power, const std::array<float, 128>& table,
+                     float& lastVoltage, std::uint32_t& lastWrite) {
+        const float voltage = std::round(powerToVoltage(compensate(power, table)));
+        if (!immediate && outputSettings.skipRedundantWrites && voltage == lastVoltage && now - lastWrite < 100) {
+            return;
+        }
+        motors->move_voltage(voltage);
+        lastVoltage = voltage;
+        lastWrite = now;
+    };
+    write(drivetrain.leftMotors, leftOutput, driveCalibration.left, leftVoltage, leftWriteTime);
+    write(drivetrain.rightMotors, rightOutput, driveCalibration.right, rightVoltage, rightWriteTime);
+}
+
+void lemlib::Chassis::invalidateDriveOutput() {
+    leftVoltage = NAN;
+    rightVoltage = NAN;
+}
+
+lemlib::ProfileSettings lemlib::Chassis::getProfileSettings(Axis axis) const {
+    ProfileSettings settings = axis == Axis::ANGULAR ? angularProfile : lateralProfile;
+    // top speed of the drivetrain, in inches per second or degrees per second
+    float topSpeed = drivetrain.rpm * M_PI * drivetrain.wheelDiameter / 60;
+    if (axis == Axis::ANGULAR) topSpeed = radToDeg(2 * topSpeed / drivetrain.trackWidth);
+    if (settings.maxVelocity <= 0) settings.maxVelocity = topSpeed;
+    if (settings.kV <= 0 && topSpeed > 0) settings.kV = 127 / topSpeed;
+    return settings;
+}
@@ -0,0 +1,97 @@
+#include <cmath>
+#include <algorithm>
+#include "lemlib/chassis/chassis.hpp"
+#include "lemlib/logger/logger.hpp"
+#include "lemlib/timer.hpp"
+#include "lemlib/util.hpp"
+
+lemlib::AutotuneResult lemlib::Chassis::autotune(Axis axis, int timeout, AutotuneParams params) {
+    this->requestMotionStart();
+    // were all motions cancelled?
+    if (!this->motionRunning) return {};
+    const bool angular = axis == Axis::ANGULAR;
+    ControllerSettings& settings = angular ? angularSettings : lateralSettings;
+    if (std::isnan(params.stepSize)) params.stepSize = angular ? 90 : 24;
+    distTraveled = 0;
+    Timer timer(timeout);
+
+    // position along the axis being tuned, relative to the starting pose. Inches or degrees
+    const Pose start = getPose();
+    auto position = [&]() {
+        const Pose pose = getPose();
+        if (angular) return pose.theta - start.theta;
+        const float heading = degToRad(start.theta);
+        return float((pose.x - start.x) * sin(heading) + (pose.y - start.y) * cos(heading));
+    };
+    // the relay has to switch instantly, so the output stage's slew and jerk limits are skipped
+    auto move = [&](float output) {
+        setDrivePower(output, angular ? -output : output, true);
+    };
+
+    // relay experiment
+    RelayExperiment relay(params);
+    while (!timer.isDone() && this->motionRunning && !relay.isDone()) {
+        const float x = position();
+        distTraveled = fabs(x);
+        move(relay.update(x, pros::millis() / 1000.0));
+        pros::delay(10);
+    }
+    move(0);
+
+    AutotuneResult result = relay.getResult();
+    if (!result.success) {
+        infoSink()->error("Autotune: couldn't measure a steady oscillation, try a larger relay output or timeout");
+        (angular ? angularTuneResult : lateralTuneResult) = result;
+        distTraveled = -1;
+        this->endMotion();
+        return result;
+    }
+    infoSink()->info("Autotune: Ku = {}, Tu = {}s, kP = {}, kI = {}, kD = {}", result.ku, result.tu, result.kP,
+                     result.kI, result.kD);
+    if (result.amplitude < 10 * params.hysteresis)
+        infoSink()->warn("Autotune: the oscillation is small compared to the hysteresis, so Ku is underestimated. "
+                         "Try a smaller hysteresis or a larger relay output");
+
+    // measure the step response with the new gains
+    if (params.stepSize > 0 && !timer.isDone() && this->motionRunning) {
+        PID pid(result.kP, result.kI, result.kD, settings.windupRange, true);
+        ExitCondition settled(settings.smallError, settings.smallErrorTimeout);
+        const float target = position() + params.stepSize;
+        StepResponse step(target, params.stepSize, settings.smallError, pros::millis() / 1000.0);
+        while (!timer.isDone() && this->motionRunning && !settled.getExit()) {
+            const float x = position();
+            const float error = target - x;
+            step.update(x, pros::millis() / 1000.0);
+            settled.update(error);
+            distTraveled = fabs(x);
+            move(std::clamp(pid.update(error, 0, x), -127.0f, 127.0f));
+            pros::delay(10);
+        }
+        move(0);
+        result.overshoot = step.getOvershoot();
+        result.settlingTime = step.getSettlingTime() * 1000;
+        if (!settled.getExit()) infoSink()->warn("Autotune: the step with the new gains didn't settle");
+        infoSink()->info("Autotune: overshoot = {}%, settling time = {}ms", result.overshoot * 100,
+                         result.settlingTime);
+    }
+
+    // use the new gains
+    if (params.apply) {
+        settings.kP = result.kP;
+        settings.kI = result.kI;
+        settings.kD = result.kD;
+        PID& pid = angular ? angularPID : lateralPID;
+        pid.setGains(result.kP, result.kI, result.kD);
+        if (pid.getGainSchedule().isEnabled())
+            infoSink()->warn("Autotune: a gain schedule is set, so it's used instead of the new gains");
+    }
+    (angular ? angularTuneResult : lateralTuneResult) = result;
+    // set distTraveled to -1 to indicate that the function has finished
+    distTraveled = -1;
+    this->endMotion();
+    return result;
+}
+
+lemlib::AutotuneResult lemlib::Chassis::getAutotuneResult(Axis axis) const {
+    return axis == Axis::ANGULAR ? angularTuneResult : lateralTuneResult;
+}
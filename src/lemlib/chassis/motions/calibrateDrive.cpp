@@ -0,0 +1,95 @@
+#include <cmath>
+#include <algorithm>
+#include "lemlib/chassis/chassis.hpp"
+#include "lemlib/logger/logger.hpp"
+#include "lemlib/timer.hpp"
+
+lemlib::DriveCalibration lemlib::Chassis::calibrateDrive(int timeout, DriveCalibrationParams params) {
+    this->requestMotionStart();
+    // were all motions cancelled?
+    if (!this->motionRunning) return {};
+    params.step = std::clamp(params.step, 1.0f, 127.0f);
+    DriveCalibration result;
+    distTraveled = 0;
+    Timer timer(timeout);
+
+    // average speed of the motors of a side, in rpm
+    auto speed = [](pros::MotorGroup* motors) {
+        const std::vector<double> velocities = motors->get_actual_velocity_all();
+        double sum = 0;
+        for (const double velocity : velocities) sum += velocity;
+        return velocities.empty() ? 0.0f : float(std::fabs(sum / velocities.size()));
+    };
+    // wait, checking if the calibration was cancelled
+    auto wait = [&](int time) {
+        for (int elapsed = 0; elapsed < time && !timer.isDone() && this->motionRunning; elapsed += 10) pros::delay(10);
+    };
+
+    // sweep the power while turning in place, so the robot doesn't need room to drive
+    // the motors are commanded directly, so nothing in the output stage affects the measurements
+    std::vector<float> powers;
+    std::vector<float> leftSpeeds;
+    std::vector<float> rightSpeeds;
+    for (float power = 0; !timer.isDone() && this->motionRunning; power = std::min(power + params.step, 127.0f)) {
+        drivetrain.leftMotors->move_voltage(powerToVoltage(power));
+        drivetrain.rightMotors->move_voltage(powerToVoltage(-power));
+        wait(params.settleTime);
+        float leftSum = 0;
+        float rightSum = 0;
+        int samples = 0;
+        for (int elapsed = 0; elapsed < params.sampleTime && !timer.isDone() && this->motionRunning; elapsed += 10) {
+            leftSum += speed(drivetrain.leftMotors);
+            rightSum += speed(drivetrain.rightMotors);
+            samples++;
+            pros::delay(10);
+        }
+        if (samples == 0) break;
+        powers.push_back(power);
+        leftSpeeds.push_back(leftSum / samples);
+        rightSpeeds.push_back(rightSum / samples);
+        infoSink()->debug("Calibration: power {}, left speed {}, right speed {}", power, leftSpeeds.back(),
+                          rightSpeeds.back());
+        if (power >= 127) break;
+    }
+    drivetrain.leftMotors->move_voltage(0);
+    drivetrain.rightMotors->move_voltage(0);
+    invalidateDriveOutput();
+
+    // invert the measurements of a side into a table of the power needed for each output power. The output power is
+    // the fraction of the side's top speed, so the sides match even if one is faster than the other
+    auto invert = [&](std::vector<float>& speeds, std::array<float, 128>& table) {
+        // the speed can't decrease as the power increases. Anything else is noise
+        for (std::size_t i = 1; i < speeds.size(); i++) speeds[i] = std::max(speeds[i], speeds[i - 1]);
+        const float topSpeed = speeds.back();
+        if (topSpeed <= 0) return false;
+        std::size_t i = 1;
+        table[0] = 0;
+        for (int output = 1; output < 128; output++) {
+            const float target = output / 127.0f * topSpeed;
+            while (speeds[i] < target) i++;
+            const float gap = std::max(speeds[i] - speeds[i - 1], 1e-6f);
+            const float t = std::clamp((target - speeds[i - 1]) / gap, 0.0f, 1.0f);
+            table[output] = powers[i - 1] + (powers[i] - powers[i - 1]) * t;
+        }
+        return true;
+    };
+    if (powers.size() < 2 || powers.back() < 127) {
+        infoSink()->error("Calibration: timed out before reaching full power, try a longer timeout");
+    } else if (!invert(leftSpeeds, result.left) || !invert(rightSpeeds, result.right)) {
+        infoSink()->error("Calibration: the drivetrain didn't move");
+    } else {
+        result.success = true;
+        infoSink()->info("Calibration: the left side starts moving at {} power, the right side at {} power",
+                         result.left[1], result.right[1]);
+        if (params.apply) driveCalibration = result;
+    }
+
+    // set distTraveled to -1 to indicate that the function has finished
+    distTraveled = -1;
+    this->endMotion();
+    return result;
+}
+
+void lemlib::Chassis::setDriveCalibration(const DriveCalibration& calibration) { driveCalibration = calibration; }
+
+lemlib::DriveCalibration lemlib::Chassis::getDriveCalibration() const { return driveCalibration; }
@@ -0,0 +1,133 @@
+#include <cmath>
+#include <algorithm>
+#include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
+#include "lemlib/logger/logger.hpp"
+#include "lemlib/motionProfile.hpp"
+#include "lemlib/timer.hpp"
+#include "lemlib/util.hpp"
+
+void lemlib::Chassis::driveArc(float radius, float angle, int timeout, DriveArcParams params, bool async) {
+    // a radius of 0 is a turn in place, which has no curvature
+    if (radius == 0) {
+        infoSink()->error("driveArc: radius can't be 0, use turnToHeading to turn in place");
+        return;
+    }
+    driveCurvature(1 / radius, std::fabs(radius) * degToRad(angle), timeout, params, async);
+}
+
+void lemlib::Chassis::driveCurvature(float curvature, float distance, int timeout, DriveArcParams params,
+                                     bool async) {
+    params.minSpeed = std::fabs(params.minSpeed);
+    this->requestMotionStart();
+    // were all motions cancelled?
+    if (!this->motionRunning) return;
+    // if the function is async, run it in a new task
+    if (async) {
+        pros::Task task([&]() { driveCurvature(curvature, distance, timeout, params, false); });
+        this->endMotion();
+        pros::delay(10); // delay to give the task time to start
+        return;
+    }
+
+    distTraveled = 0;
+    Timer timer(timeout);
+    lateralLargeExit.reset();
+    lateralSmallExit.reset();
+    lateralPID.reset();
+    angularPID.reset();
+
+    const Pose start = getPose();
+    const float startHeading = degToRad(start.theta);
+    const float direction = distance < 0 ? -1 : 1;
+    const float length = std::fabs(distance);
+    const bool straight = std::fabs(curvature) < 1e-6;
+    // the arc is centered on a point to the side of the robot
+    const float radius = straight ? 0 : 1 / curvature;
+    const Pose center(start.x + radius * cos(startHeading), start.y - radius * sin(startHeading));
+    // how much faster each side moves than the center of the robot
+    const float leftRatio = 1 + curvature * drivetrain.trackWidth / 2;
+    const float rightRatio = 1 - curvature * drivetrain.trackWidth / 2;
+
+    // plan the speed along the arc. The outer side moves faster, so it limits how fast the robot can go
+    const ProfileSettings settings = getProfileSettings(Axis::LATERAL);
+    const float outerRatio = std::max(std::fabs(leftRatio), std::fabs(rightRatio));
+    const float maxVelocity = settings.maxVelocity * std::fabs(params.maxSpeed) / 127 / outerRatio;
+    const float endVelocity = settings.maxVelocity * params.minSpeed / 127 / outerRatio;
+    const MotionProfile profile(length, maxVelocity, settings.maxAcceleration, settings.maxJerk,
+                                direction * getLocalSpeed().y, endVelocity);
+    const std::uint32_t startTime = pros::millis();
+
+    // signed distance along the arc and distance to the left of it. The angle around the center is accumulated so
+    // arcs longer than half a circle are measured correctly
+    float arcLength = 0;
+    Pose prevRadial = start - center;
+    auto update = [&](const Pose& pose, float& crossTrack) {
+        if (straight) {
+            const Pose delta = pose - start;
+            crossTrack = -delta.x * cos(startHeading) + delta.y * sin(startHeading);
+            return float(delta.x * sin(startHeading) + delta.y * cos(startHeading));
+        }
+        const Pose radial = pose - center;
+        const float sweep =
+            atan2(prevRadial.x * radial.y - prevRadial.y * radial.x, prevRadial.x * radial.x + prevRadial.y * radial.y);
+        prevRadial = radial;
+        arcLength -= radius * sweep;
+        crossTrack = sgn(curvature) * (std::hypot(radial.x, radial.y) - std::fabs(radius));
+        return arcLength;
+    };
+
+    // main loop
+    // the profile has to finish before the exit conditions are checked
+    bool profileDone = false;
+    while (!timer.isDone() && ((!lateralLargeExit.getExit() && !lateralSmallExit.getExit()) || !profileDone) &&
+           this->motionRunning) {
+        const Pose pose = getPose();
+        float crossTrack;
+        const float progress = direction * update(pose, crossTrack);
+        distTraveled = std::fabs(progress);
+        const ProfileState state = profile.sample((pros::millis() - startTime) / 1000.0);
+        profileDone = state.time >= profile.getDuration();
+
+        // motion chaining
+        if (params.minSpeed != 0 && progress >= length - params.earlyExitRange) break;
+
+        // update exit conditions
+        lateralLargeExit.update(length - progress);
+        lateralSmallExit.update(length - progress, direction * getLocalSpeed().y);
+
+        // the heading the robot should have at this point on the arc, turned towards the arc if it has drifted off
+        const float targetHeading = start.theta + radToDeg(curvature * direction * progress) +
+                                    direction * radToDeg(atan2(crossTrack, params.correctionDistance));
+        const float angularOut = angularPID.update(targetHeading - pose.theta, 0, pose.theta);
+        const float lateralOut = lateralPID.update(state.position - progress);
+
+        // feedforward for each side from the exact wheel speeds, and PID to correct for errors in following the arc
+        auto sidePower = [&](float ratio) {
+            const float velocity = direction * state.velocity * ratio;
+            const float acceleration = direction * state.acceleration * ratio;
+            return settings.kS * sgn(velocity) * (state.velocity > 0) + settings.kV * velocity +
+                   settings.kA * acceleration + direction * ratio * lateralOut;
+        };
+        const float leftFeedforward = sidePower(leftRatio);
+        const float rightFeedforward = sidePower(rightRatio);
+
+        // move the drivetrain
+        const auto [leftPower, rightPower] =
+            setDriveOutput((leftFeedforward + rightFeedforward) / 2,
+                           (leftFeedforward - rightFeedforward) / 2 + angularOut, params.maxSpeed);
+        if (checkStall(leftPower, rightPower)) break;
+
+        infoSink()->debug("Profile Distance: {}, Progress: {}, Cross Track: {}, Left Power: {}, Right Power: {}",
+                          state.position, progress, crossTrack, leftPower, rightPower);
+
+        pros::delay(10);
+    }
+
+    // stop the drivetrain
+    setDrivePower(0, 0, true);
+    applyStallAction();
+    // set distTraveled to -1 to indicate that the function has finished
+    distTraveled = -1;
+    this->endMotion();
+}
@@ -1,6 +1,8 @@
 #include <cmath>
 #include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
 #include "lemlib/logger/logger.hpp"
+#include "lemlib/motionProfile.hpp"
 #include "lemlib/timer.hpp"
 #include "lemlib/util.hpp"
 #include "pros/misc.hpp"
@@ -17,6 +19,10 @@ void lemlib::Chassis::moveToPoint(float x, float y, int timeout, MoveToPointPara
         pros::delay(10); // delay to give the task time to start
         return;
     }
+    if (params.profiled) {
+        moveToPointProfiled(x, y, timeout, params);
+        return;
+    }
 
     // reset PIDs and exit conditions
     lateralPID.reset();
@@ -72,12 +78,13 @@ void lemlib::Chassis::moveToPoint(float x, float y, int timeout, MoveToPointPara
         float lateralError = pose.distance(target) * cos(angleError(pose.theta, pose.angle(target)));
 
         // update exit conditions
-        lateralSmallExit.update(lateralError);
+        lateralSmallExit.update(lateralError, getLocalSpeed().y);
         lateralLargeExit.update(lateralError);
 
         // get output from PIDs
         float lateralOut = lateralPID.update(lateralError);
-        float angularOut = angularPID.update(radToDeg(angularError));
+        // the angular error increases with the standard position heading, so the measurement is its negative
+        float angularOut = angularPID.update(radToDeg(angularError), 0, -radToDeg(pose.theta));
         if (close) angularOut = 0;
 
         // apply restrictions on angular speed
@@ -88,7 +95,7 @@ void lemlib::Chassis::moveToPoint(float x, float y, int timeout, MoveToPointPara
         lateralOut = std::clamp(lateralOut, -params.maxSpeed, params.maxSpeed);
         // constrain lateral output by max accel
         // but not for decelerating, since that would interfere with settling
-        if (!close) lateralOut = slew(lateralOut, prevLateralOut, lateralSettings.slew);
+        if (!close) lateralOut = tractionSlew(lateralOut, prevLateralOut, lateralSettings.slew);
 
         // prevent moving in the wrong direction
         if (params.forwards && !close) lateralOut = std::fmax(lateralOut, 0);
@@ -105,27 +112,107 @@ void lemlib::Chassis::moveToPoint(float x, float y, int timeout, MoveToPointPara
 
         infoSink()->debug("Angular Out: {}, Lateral Out: {}", angularOut, lateralOut);
 
-        // ratio the speeds to respect the max speed
-        float leftPower = lateralOut + angularOut;
-        float rightPower = lateralOut - angularOut;
-        const float ratio = std::max(std::fabs(leftPower), std::fabs(rightPower)) / params.maxSpeed;
-        if (ratio > 1) {
-            leftPower /= ratio;
-            rightPower /= ratio;
-        }
+        // move the drivetrain
+        const auto [leftPower, rightPower] = setDriveOutput(lateralOut, angularOut, params.maxSpeed);
+        if (checkStall(leftPower, rightPower)) break;
+
+        // delay to save resources
+        pros::delay(10);
+    }
+
+    // stop the drivetrain
+    setDrivePower(0, 0, true);
+    applyStallAction();
+    // set distTraveled to -1 to indicate that the function has finished
+    distTraveled = -1;
+    this->endMotion();
+}
+
+void lemlib::Chassis::moveToPointProfiled(float x, float y, int timeout, MoveToPointParams params) {
+    // reset PIDs and exit conditions
+    lateralPID.reset();
+    lateralLargeExit.reset();
+    lateralSmallExit.reset();
+    angularPID.reset();
+
+    // initialize vars used between iterations
+    const Pose start = getPose(true, true);
+    Pose lastPose = start;
+    distTraveled = 0;
+    Timer timer(timeout);
+    float prevAngularOut = 0; // previous angular power
+    const float direction = params.forwards ? 1 : -1;
+
+    // plan the profile along the line to the target, starting from the current velocity
+    Pose target(x, y);
+    target.theta = start.angle(target);
+    const float distance = start.distance(target);
+    const ProfileSettings settings = getProfileSettings(Axis::LATERAL);
+    const float maxVelocity = settings.maxVelocity * std::fabs(params.maxSpeed) / 127;
+    const float endVelocity = settings.maxVelocity * std::fabs(params.minSpeed) / 127;
+    const MotionProfile profile(distance, maxVelocity, settings.maxAcceleration, settings.maxJerk,
+                                direction * getLocalSpeed().y, endVelocity);
+    const std::uint32_t startTime = pros::millis();
+
+    // main loop
+    // the profile has to finish before the exit conditions are checked
+    bool profileDone = false;
+    while (!timer.isDone() && ((!lateralSmallExit.getExit() && !lateralLargeExit.getExit()) || !profileDone) &&
+           this->motionRunning) {
+        // update position
+        const Pose pose = getPose(true, true);
+
+        // update distance traveled
+        distTraveled += pose.distance(lastPose);
+        lastPose = pose;
+
+        // where the robot should be, and how far it has moved along the line to the target
+        const ProfileState state = profile.sample((pros::millis() - startTime) / 1000.0);
+        profileDone = state.time >= profile.getDuration();
+        const float progress = (pose.x - start.x) * cos(target.theta) + (pose.y - start.y) * sin(target.theta);
+        const float distTarget = pose.distance(target);
+
+        // motion chaining
+        if (params.minSpeed != 0 && progress >= distance - params.earlyExitRange) break;
+
+        // calculate error
+        const float adjustedRobotTheta = params.forwards ? pose.theta : pose.theta + M_PI;
+        const float angularError = angleError(adjustedRobotTheta, pose.angle(target));
+        const float lateralError = distTarget * cos(angleError(pose.theta, pose.angle(target)));
+
+        // update exit conditions
+        lateralSmallExit.update(lateralError, getLocalSpeed().y);
+        lateralLargeExit.update(lateralError);
+
+        // feedforward from the profile, and PID to correct for errors in following it
+        const float feedforward = settings.kS * (state.velocity > 0) + settings.kV * state.velocity +
+                                  settings.kA * state.acceleration +
+                                  settings.kVelocity * (state.velocity - direction * getLocalSpeed().y);
+        float lateralOut = direction * (feedforward + lateralPID.update(state.position - progress));
+        // the angular error is unreliable close to the target
+        float angularOut = angularPID.update(radToDeg(angularError), 0, -radToDeg(pose.theta));
+        if (distTarget < 7.5) angularOut = 0;
+
+        // apply restrictions on angular speed
+        angularOut = std::clamp(angularOut, -params.maxSpeed, params.maxSpeed);
+        angularOut = slew(angularOut, prevAngularOut, angularSettings.slew);
+        prevAngularOut = angularOut;
+        lateralOut = std::clamp(lateralOut, -params.maxSpeed, params.maxSpeed);
+
+        infoSink()->debug("Profile Position: {}, Progress: {}, Lateral Out: {}", state.position, progress, lateralOut);
 
         // move the drivetrain
-        drivetrain.leftMotors->move(leftPower);
-        drivetrain.rightMotors->move(rightPower);
+        const auto [leftPower, rightPower] = setDriveOutput(lateralOut, angularOut, params.maxSpeed);
+        if (checkStall(leftPower, rightPower)) break;
 
         // delay to save resources
         pros::delay(10);
     }
 
     // stop the drivetrain
-    drivetrain.leftMotors->move(0);
-    drivetrain.rightMotors->move(0);
+    setDrivePower(0, 0, true);
+    applyStallAction();
     // set distTraveled to -1 to indicate that the function has finished
     distTraveled = -1;
     this->endMotion();
-}
\ No newline at end of file
+}
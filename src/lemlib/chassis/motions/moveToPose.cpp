@@ -1,5 +1,6 @@
 #include <cmath>
 #include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
 #include "lemlib/logger/logger.hpp"
 #include "lemlib/timer.hpp"
 #include "lemlib/util.hpp"
@@ -93,14 +94,15 @@ void lemlib::Chassis::moveToPose(float x, float y, float theta, int timeout, Mov
         else lateralError *= sgn(cos(angleError(pose.theta, pose.angle(carrot))));
 
         // update exit conditions
-        lateralSmallExit.update(lateralError);
+        lateralSmallExit.update(lateralError, getLocalSpeed().y);
         lateralLargeExit.update(lateralError);
-        angularSmallExit.update(radToDeg(angularError));
+        angularSmallExit.update(radToDeg(angularError), getLocalSpeed().theta);
         angularLargeExit.update(radToDeg(angularError));
 
         // get output from PIDs
         float lateralOut = lateralPID.update(lateralError);
-        float angularOut = angularPID.update(radToDeg(angularError));
+        // the angular error increases with the standard position heading, so the measurement is its negative
+        float angularOut = angularPID.update(radToDeg(angularError), 0, -radToDeg(pose.theta));
 
         // apply restrictions on angular speed
         angularOut = std::clamp(angularOut, -params.maxSpeed, params.maxSpeed);
@@ -109,16 +111,16 @@ void lemlib::Chassis::moveToPose(float x, float y, float theta, int timeout, Mov
         lateralOut = std::clamp(lateralOut, -params.maxSpeed, params.maxSpeed);
 
         // constrain lateral output by max accel
-        if (!close) lateralOut = slew(lateralOut, prevLateralOut, lateralSettings.slew);
+        if (!close) lateralOut = tractionSlew(lateralOut, prevLateralOut, lateralSettings.slew);
 
         // constrain lateral output by the max speed it can travel at without
         // slipping
         const float radius = 1 / fabs(getCurvature(pose, carrot));
         const float maxSlipSpeed(sqrt(params.horizontalDrift * radius * 9.8));
         lateralOut = std::clamp(lateralOut, -maxSlipSpeed, maxSlipSpeed);
-        // prioritize angular movement over lateral movement
-        const float overturn = fabs(angularOut) + fabs(lateralOut) - params.maxSpeed;
-        if (overturn > 0) lateralOut -= lateralOut > 0 ? overturn : -overturn;
+        // prioritize angular movement over lateral movement. This has to happen before the clamps below, so the
+        // minimum speed still holds for chaining and the slew starts from what was actually sent
+        desaturate(lateralOut, angularOut, params.maxSpeed, Desaturation::ANGULAR_PRIORITY);
 
         // prevent moving in the wrong direction
         if (params.forwards && !close) lateralOut = std::fmax(lateralOut, 0);
@@ -135,26 +137,17 @@ void lemlib::Chassis::moveToPose(float x, float y, float theta, int timeout, Mov
 
         infoSink()->debug("lateralOut: {} angularOut: {}", lateralOut, angularOut);
 
-        // ratio the speeds to respect the max speed
-        float leftPower = lateralOut + angularOut;
-        float rightPower = lateralOut - angularOut;
-        const float ratio = std::max(std::fabs(leftPower), std::fabs(rightPower)) / params.maxSpeed;
-        if (ratio > 1) {
-            leftPower /= ratio;
-            rightPower /= ratio;
-        }
-
-        // move the drivetrain
-        drivetrain.leftMotors->move(leftPower);
-        drivetrain.rightMotors->move(rightPower);
+        // move the drivetrain. The minimum speed can push the total back over the maximum, which is ratioed down
+        const auto [leftPower, rightPower] = setDriveOutput(lateralOut, angularOut, params.maxSpeed);
+        if (checkStall(leftPower, rightPower)) break;
 
         // delay to save resources
         pros::delay(10);
     }
 
     // stop the drivetrain
-    drivetrain.leftMotors->move(0);
-    drivetrain.rightMotors->move(0);
+    setDrivePower(0, 0, true);
+    applyStallAction();
     // set distTraveled to -1 to indicate that the function has finished
     distTraveled = -1;
     this->endMotion();
@@ -4,11 +4,16 @@
 // https://www.chiefdelphi.com/uploads/default/original/3X/b/e/be0e06de00e07db66f97686505c3f4dde2e332dc.pdf
 
 #include <cmath>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include "pros/misc.hpp"
 #include "lemlib/logger/logger.hpp"
 #include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
+#include "lemlib/motionProfile.hpp"
+#include "lemlib/mpc.hpp"
+#include "lemlib/timer.hpp"
 #include "lemlib/util.hpp"
 
 /**
@@ -96,9 +101,9 @@ std::vector<lemlib::Pose> getData(const asset& path) {
  * @param path the path to follow
  * @return int index to the closest point
  */
-int findClosest(lemlib::Pose pose, std::vector<lemlib::Pose> path) {
+int findClosest(lemlib::Pose pose, const std::vector<lemlib::Pose>& path) {
     int closestPoint;
-    float closestDist = infinity();
+    float closestDist = INFINITY;
 
     // loop through all path points
     for (int i = 0; i < path.size(); i++) {
@@ -155,8 +160,8 @@ float circleIntersect(lemlib::Pose p1, lemlib::Pose p2, lemlib::Pose pose, float
  * @param closest - the index of the point closest to the robot
  * @param lookaheadDist - the lookahead distance of the algorithm
  */
-lemlib::Pose lookaheadPoint(lemlib::Pose lastLookahead, lemlib::Pose pose, std::vector<lemlib::Pose> path, int closest,
-                            float lookaheadDist) {
+lemlib::Pose lookaheadPoint(lemlib::Pose lastLookahead, lemlib::Pose pose, const std::vector<lemlib::Pose>& path,
+                            int closest, float lookaheadDist) {
     // optimizations applied:
     // only consider intersections that have an index greater than or equal to the point closest
     // to the robot
@@ -229,8 +234,6 @@ void lemlib::Chassis::follow(const asset& path, float lookahead, int timeout, bo
     lastLookahead.theta = 0;
     float curvature;
     float targetVel;
-    float prevLeftVel = 0;
-    float prevRightVel = 0;
     int closestPoint;
     float leftInput = 0;
     float rightInput = 0;
@@ -263,41 +266,253 @@ void lemlib::Chassis::follow(const asset& path, float lookahead, int timeout, bo
 
         // get the target velocity of the robot
         targetVel = pathPoints.at(closestPoint).theta;
-        targetVel = slew(targetVel, prevVel, lateralSettings.slew);
+        targetVel = tractionSlew(targetVel, prevVel, lateralSettings.slew);
         prevVel = targetVel;
 
-        // calculate target left and right velocities
-        float targetLeftVel = targetVel * (2 + curvature * drivetrain.trackWidth) / 2;
-        float targetRightVel = targetVel * (2 - curvature * drivetrain.trackWidth) / 2;
+        // move the drivetrain. The difference between the sides makes the robot follow the curvature
+        const float turnVel = targetVel * curvature * drivetrain.trackWidth / 2;
+        const auto [leftPower, rightPower] = setDriveOutput(forwards ? targetVel : -targetVel, turnVel);
+        if (checkStall(leftPower, rightPower)) break;
 
-        // ratio the speeds to respect the max speed
-        float ratio = std::max(std::fabs(targetLeftVel), std::fabs(targetRightVel)) / 127;
-        if (ratio > 1) {
-            targetLeftVel /= ratio;
-            targetRightVel /= ratio;
+        pros::delay(10);
+    }
+
+    // stop the robot
+    setDrivePower(0, 0, true);
+    applyStallAction();
+    // set distTraveled to -1 to indicate that the function has finished
+    distTraveled = -1;
+    // give the mutex back
+    this->endMotion();
+}
+
+/**
+ * @brief Fit a cubic Hermite spline through points, and sample it densely
+ *
+ * Points without a heading get the tangent of a Catmull-Rom spline, so the path passes through them smoothly
+ *
+ * @param points points to pass through. Headings are in degrees, NAN if the point doesn't have one
+ * @param path sampled points on the spline. Theta is the heading of the spline, in radians
+ * @param distances distance along the spline of every sampled point
+ * @param curvatures curvature of the spline at every sampled point. Positive curves to the right
+ * @param waypointDistances distance along the spline of every point after the first
+ */
+void fitSpline(const std::vector<lemlib::Waypoint>& points, std::vector<lemlib::Pose>& path,
+               std::vector<float>& distances, std::vector<float>& curvatures, std::vector<float>& waypointDistances) {
+    // distance between samples, in inches
+    constexpr float SPACING = 0.25;
+    const std::size_t n = points.size();
+    auto chord = [&](std::size_t i) {
+        return std::hypot(points[i + 1].x - points[i].x, points[i + 1].y - points[i].y);
+    };
+
+    // tangent at every point. The length is scaled by the distance to the neighbouring points
+    std::vector<lemlib::Pose> tangents;
+    tangents.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        const std::size_t prev = i == 0 ? 0 : i - 1;
+        const std::size_t next = std::min(i + 1, n - 1);
+        if (std::isnan(points[i].theta)) {
+            const float scale = (i == 0 || i == n - 1) ? 1 : 0.5;
+            tangents.emplace_back((points[next].x - points[prev].x) * scale, (points[next].y - points[prev].y) * scale);
+        } else {
+            const float length = (i == 0) ? chord(0) : (i == n - 1) ? chord(n - 2) : (chord(i - 1) + chord(i)) / 2;
+            const float heading = lemlib::degToRad(points[i].theta);
+            tangents.emplace_back(length * std::sin(heading), length * std::cos(heading));
         }
+    }
+
+    path.emplace_back(points[0].x, points[0].y, std::atan2(tangents[0].x, tangents[0].y));
+    distances.push_back(0);
+    curvatures.push_back(0);
+    for (std::size_t i = 0; i + 1 < n; i++) {
+        const lemlib::Pose p0(points[i].x, points[i].y);
+        const lemlib::Pose p1(points[i + 1].x, points[i + 1].y);
+        const lemlib::Pose& t0 = tangents[i];
+        const lemlib::Pose& t1 = tangents[i + 1];
+        const int samples = std::max(2, int(std::ceil(chord(i) / SPACING)));
+        for (int j = 1; j <= samples; j++) {
+            const float t = float(j) / samples;
+            const float t2 = t * t;
+            const float t3 = t2 * t;
+            // hermite basis functions, and their first and second derivatives
+            const lemlib::Pose point = p0 * (2 * t3 - 3 * t2 + 1) + t0 * (t3 - 2 * t2 + t) + p1 * (-2 * t3 + 3 * t2) +
+                                       t1 * (t3 - t2);
+            const lemlib::Pose d1 =
+                p0 * (6 * t2 - 6 * t) + t0 * (3 * t2 - 4 * t + 1) + p1 * (-6 * t2 + 6 * t) + t1 * (3 * t2 - 2 * t);
+            const lemlib::Pose d2 = p0 * (12 * t - 6) + t0 * (6 * t - 4) + p1 * (-12 * t + 6) + t1 * (6 * t - 2);
+            const float speed = std::hypot(d1.x, d1.y);
+            // heading is clockwise, so the curvature is flipped
+            const float curvature = speed > 1e-6 ? -(d1.x * d2.y - d1.y * d2.x) / (speed * speed * speed) : 0;
+            distances.push_back(distances.back() + point.distance(path.back()));
+            path.emplace_back(point.x, point.y, std::atan2(d1.x, d1.y));
+            curvatures.push_back(curvature);
+        }
+        waypointDistances.push_back(distances.back());
+    }
+    curvatures.front() = curvatures.size() > 1 ? curvatures[1] : 0;
+}
+
+void lemlib::Chassis::moveThrough(const std::vector<Waypoint>& waypoints, int timeout, MoveThroughParams params,
+                                  bool async) {
+    params.minSpeed = std::fabs(params.minSpeed);
+    this->requestMotionStart();
+    // were all motions cancelled?
+    if (!this->motionRunning) return;
+    // if the function is async, run it in a new task
+    if (async) {
+        pros::Task task([&]() { moveThrough(waypoints, timeout, params, false); });
+        this->endMotion();
+        pros::delay(10); // delay to give the task time to start
+        return;
+    }
+    waypointIndex = -1;
+    if (waypoints.empty()) {
+        infoSink()->error("moveThrough: no waypoints! Skipping motion");
+        // set distTraveled to -1 to indicate that the function has finished
+        distTraveled = -1;
+        this->endMotion();
+        return;
+    }
+
+    // fit the spline, starting from the robot. Headings are converted to the direction the robot travels in
+    const Pose start = getPose();
+    const float flip = params.forwards ? 0 : 180;
+    std::vector<Waypoint> points = {{start.x, start.y, start.theta + flip}};
+    for (const Waypoint& waypoint : waypoints) points.push_back({waypoint.x, waypoint.y, waypoint.theta + flip});
+    std::vector<Pose> path;
+    std::vector<float> distances;
+    std::vector<float> curvatures;
+    std::vector<float> waypointDistances;
+    fitSpline(points, path, distances, curvatures, waypointDistances);
+    const float length = distances.back();
+    // every waypoint is on top of the robot, so there's no path to follow
+    if (length < 1e-3) {
+        infoSink()->warn("moveThrough: the path has no length! Skipping motion");
+        // set distTraveled to -1 to indicate that the function has finished
+        distTraveled = -1;
+        this->endMotion();
+        return;
+    }
 
-        // update previous velocities
-        prevLeftVel = targetLeftVel;
-        prevRightVel = targetRightVel;
+    // plan one profile along the whole path. The outer side moves faster around corners, so it limits how fast the
+    // robot can go
+    const ProfileSettings settings = getProfileSettings(Axis::LATERAL);
+    const float maxVelocity = settings.maxVelocity * std::fabs(params.maxSpeed) / 127;
+    const int buckets = std::clamp(int(length), 1, 200);
+    std::vector<float> limits(buckets + 1, maxVelocity);
+    for (std::size_t i = 0; i < path.size(); i++) {
+        const int bucket = std::round(distances[i] / length * buckets);
+        const float limit = maxVelocity / (1 + std::fabs(curvatures[i]) * drivetrain.trackWidth / 2);
+        limits[bucket] = std::min(limits[bucket], limit);
+    }
+    const float endVelocity = settings.maxVelocity * params.minSpeed / 127;
+    const float direction = params.forwards ? 1 : -1;
+    const MotionProfile profile(length, limits, settings.maxAcceleration, settings.maxJerk,
+                                direction * getLocalSpeed().y, endVelocity);
+    const std::uint32_t startTime = pros::millis();
 
-        // move the drivetrain
-        if (forwards) {
-            drivetrain.leftMotors->move(targetLeftVel);
-            drivetrain.rightMotors->move(targetRightVel);
+    distTraveled = 0;
+    Timer timer(timeout);
+    lateralLargeExit.reset();
+    lateralSmallExit.reset();
+    lateralPID.reset();
+    Pose lastLookahead = path.front();
+    lastLookahead.theta = 0;
+    std::size_t closest = 0;
+    // the model predictive controller tracks where the profile says the robot should be over the next few steps
+    MPC mpc(drivetrain.trackWidth, mpcSettings);
+    std::vector<MPCReference> trajectory(mpcSettings.horizon);
+    auto pathIndex = [&](float distance) {
+        const auto it = std::lower_bound(distances.begin(), distances.end(), distance);
+        return std::min<std::size_t>(it - distances.begin(), path.size() - 1);
+    };
+
+    // main loop
+    // the profile has to finish before the exit conditions are checked
+    bool profileDone = false;
+    while (!timer.isDone() && ((!lateralLargeExit.getExit() && !lateralSmallExit.getExit()) || !profileDone) &&
+           this->motionRunning) {
+        Pose pose = getPose(true);
+        if (!params.forwards) pose.theta -= M_PI;
+
+        // find the closest point. The robot only moves forwards along the path, so only points ahead are checked
+        for (std::size_t i = closest + 1; i < path.size() && distances[i] - distances[closest] < params.lookahead;
+             i++) {
+            if (pose.distance(path[i]) < pose.distance(path[closest])) closest = i;
+        }
+        const float progress = distances[closest];
+        distTraveled = progress;
+        while (waypointIndex + 1 < int(waypointDistances.size()) && progress >= waypointDistances[waypointIndex + 1]) {
+            waypointIndex++;
+        }
+        const ProfileState state = profile.sample((pros::millis() - startTime) / 1000.0);
+        profileDone = state.time >= profile.getDuration();
+
+        // motion chaining
+        if (params.minSpeed != 0 && progress >= length - params.earlyExitRange) break;
+
+        // update exit conditions
+        const float remaining = pose.distance(path.back());
+        lateralLargeExit.update(remaining);
+        lateralSmallExit.update(remaining, getLocalSpeed().y);
+
+        // wheel velocities, and the wheel velocities the profile would have on its own
+        float leftVelocity;
+        float rightVelocity;
+        float leftRatio;
+        float rightRatio;
+        float lateralOut = 0;
+        if (params.mpc) {
+            const float time = (pros::millis() - startTime) / 1000.0;
+            for (int k = 0; k < mpcSettings.horizon; k++) {
+                const ProfileState future = profile.sample(time + k * mpcSettings.timeStep);
+                trajectory[k] = {future.velocity, curvatures[pathIndex(future.position)]};
+            }
+            const float curvature = trajectory[0].curvature;
+            leftRatio = 1 + curvature * drivetrain.trackWidth / 2;
+            rightRatio = 1 - curvature * drivetrain.trackWidth / 2;
+            const MPCOutput output = mpc.update(pose, path[pathIndex(state.position)], trajectory, maxVelocity);
+            leftVelocity = output.left;
+            rightVelocity = output.right;
         } else {
-            drivetrain.leftMotors->move(-targetRightVel);
-            drivetrain.rightMotors->move(-targetLeftVel);
+            // steer towards the lookahead point. Near the end of the path, aim at the end
+            Pose lookaheadPose = lookaheadPoint(lastLookahead, pose, path, closest, params.lookahead);
+            if (remaining < params.lookahead) lookaheadPose = path.back();
+            else lastLookahead = lookaheadPose;
+            const float curvature = findLookaheadCurvature(pose, M_PI / 2 - pose.theta, lookaheadPose);
+            leftRatio = 1 + curvature * drivetrain.trackWidth / 2;
+            rightRatio = 1 - curvature * drivetrain.trackWidth / 2;
+            leftVelocity = state.velocity * leftRatio;
+            rightVelocity = state.velocity * rightRatio;
+            // PID to correct for falling behind the profile
+            lateralOut = lateralPID.update(state.position - progress);
         }
 
+        // feedforward for each side from the wheel velocities
+        auto sidePower = [&](float velocity, float ratio) {
+            return settings.kS * sgn(velocity) * (state.velocity > 0) + settings.kV * velocity +
+                   (settings.kA * state.acceleration + lateralOut) * ratio;
+        };
+        const float leftFeedforward = sidePower(leftVelocity, leftRatio);
+        const float rightFeedforward = sidePower(rightVelocity, rightRatio);
+
+        // move the drivetrain. Driving backwards, the sides swap and reverse, which keeps the turn the same
+        const float lateral = direction * (leftFeedforward + rightFeedforward) / 2;
+        const auto [leftPower, rightPower] =
+            setDriveOutput(lateral, (leftFeedforward - rightFeedforward) / 2, params.maxSpeed);
+        if (checkStall(leftPower, rightPower)) break;
+
+        infoSink()->debug("Profile Distance: {}, Progress: {}, Left Power: {}, Right Power: {}", state.position,
+                          progress, leftPower, rightPower);
+
         pros::delay(10);
     }
 
     // stop the robot
-    drivetrain.leftMotors->move(0);
-    drivetrain.rightMotors->move(0);
+    setDrivePower(0, 0, true);
+    applyStallAction();
     // set distTraveled to -1 to indicate that the function has finished
     distTraveled = -1;
-    // give the mutex back
     this->endMotion();
 }
@@ -1,6 +1,8 @@
 #include <cmath>
 #include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
 #include "lemlib/logger/logger.hpp"
+#include "lemlib/motionProfile.hpp"
 #include "lemlib/timer.hpp"
 #include "lemlib/util.hpp"
 #include "pros/misc.hpp"
@@ -18,6 +20,10 @@ void lemlib::Chassis::swingToHeading(float theta, DriveSide lockedSide, int time
         pros::delay(10); // delay to give the task time to start
         return;
     }
+    if (params.profiled) {
+        swingToHeadingProfiled(theta, lockedSide, timeout, params);
+        return;
+    }
     float targetTheta;
     float deltaTheta;
     float motorPower;
@@ -33,9 +39,8 @@ void lemlib::Chassis::swingToHeading(float theta, DriveSide lockedSide, int time
     angularSmallExit.reset();
     angularPID.reset();
     // get original braking mode of that side of the drivetrain so we can set it back to it after this motion ends
-    pros::MotorBrake brakeMode = (lockedSide == DriveSide::LEFT)
-                                     ? this->drivetrain.leftMotors->get_brake_mode_all().at(0)
-                                     : this->drivetrain.rightMotors->get_brake_mode_all().at(0);
+    pros::MotorBrake brakeMode = (lockedSide == DriveSide::LEFT) ? this->drivetrain.leftMotors->get_brake_mode()
+                                                                 : this->drivetrain.rightMotors->get_brake_mode();
     // set brake mode of the locked side to hold
     if (lockedSide == DriveSide::LEFT) this->drivetrain.leftMotors->set_brake_mode_all(pros::E_MOTOR_BRAKE_HOLD);
     else this->drivetrain.rightMotors->set_brake_mode_all(pros::E_MOTOR_BRAKE_HOLD);
@@ -66,9 +71,10 @@ void lemlib::Chassis::swingToHeading(float theta, DriveSide lockedSide, int time
         if (params.minSpeed != 0 && sgn(deltaTheta) != sgn(prevDeltaTheta)) break;
 
         // calculate the speed
-        motorPower = angularPID.update(deltaTheta);
+        // pose.theta wraps around, so the continuous heading is used as the measurement
+        motorPower = angularPID.update(deltaTheta, 0, getPose().theta);
         angularLargeExit.update(deltaTheta);
-        angularSmallExit.update(deltaTheta);
+        angularSmallExit.update(deltaTheta, getLocalSpeed().theta);
 
         // cap the speed
         if (motorPower > params.maxSpeed) motorPower = params.maxSpeed;
@@ -82,12 +88,14 @@ void lemlib::Chassis::swingToHeading(float theta, DriveSide lockedSide, int time
 
         // move the drivetrain
         if (lockedSide == DriveSide::LEFT) {
-            drivetrain.rightMotors->move(-motorPower);
+            drivetrain.rightMotors->move_voltage(powerToVoltage(-motorPower));
             drivetrain.leftMotors->brake();
         } else {
-            drivetrain.leftMotors->move(motorPower);
+            drivetrain.leftMotors->move_voltage(powerToVoltage(motorPower));
             drivetrain.rightMotors->brake();
         }
+        invalidateDriveOutput();
+        if (lockedSide == DriveSide::LEFT ? checkStall(0, -motorPower) : checkStall(motorPower, 0)) break;
 
         // delay to save resources
         pros::delay(10);
@@ -98,9 +106,100 @@ void lemlib::Chassis::swingToHeading(float theta, DriveSide lockedSide, int time
     if (lockedSide == DriveSide::LEFT) this->drivetrain.leftMotors->set_brake_mode_all(brakeMode);
     else this->drivetrain.rightMotors->set_brake_mode_all(brakeMode);
     // stop the drivetrain
-    drivetrain.leftMotors->move(0);
-    drivetrain.rightMotors->move(0);
+    setDrivePower(0, 0, true);
+    applyStallAction();
+    // set distTraveled to -1 to indicate that the function has finished
+    distTraveled = -1;
+    this->endMotion();
+}
+
+void lemlib::Chassis::swingToHeadingProfiled(float theta, DriveSide lockedSide, int timeout,
+                                             SwingToHeadingParams params) {
+    distTraveled = 0;
+    Timer timer(timeout);
+    angularLargeExit.reset();
+    angularSmallExit.reset();
+    angularPID.reset();
+    lateralPID.reset();
+
+    // where the locked wheel touches the ground
+    // it is half the track width to the side of the tracking center
+    const float offset = (lockedSide == DriveSide::LEFT ? -1 : 1) * drivetrain.trackWidth / 2;
+    auto lockedPoint = [&](const Pose& pose) {
+        const float heading = degToRad(pose.theta);
+        return Pose(pose.x + offset * cos(heading), pose.y - offset * sin(heading));
+    };
+    const Pose startPose = getPose();
+    const Pose lockedStart = lockedPoint(startPose);
+
+    // plan the profile. The robot pivots around the locked wheel, so the moving side covers the whole track width
+    // per radian, and the angular velocity is limited by how fast that side can drive
+    const float startTheta = startPose.theta;
+    const float angle = angleError(theta, startTheta, false, params.direction);
+    const float direction = sgn(angle);
+    const ProfileSettings lateral = getProfileSettings(Axis::LATERAL);
+    const ProfileSettings settings = getProfileSettings(Axis::ANGULAR);
+    const float topVelocity = std::min(settings.maxVelocity, radToDeg(lateral.maxVelocity / drivetrain.trackWidth));
+    const float maxVelocity = topVelocity * std::abs(params.maxSpeed) / 127;
+    const float endVelocity = topVelocity * std::abs(params.minSpeed) / 127;
+    const MotionProfile profile(std::fabs(angle), maxVelocity, settings.maxAcceleration, settings.maxJerk,
+                                direction * getLocalSpeed().theta, endVelocity);
+    const std::uint32_t startTime = pros::millis();
+
+    // main loop
+    // the profile has to finish before the exit conditions are checked
+    bool profileDone = false;
+    while (!timer.isDone() && ((!angularLargeExit.getExit() && !angularSmallExit.getExit()) || !profileDone) &&
+           this->motionRunning) {
+        const Pose pose = getPose();
+        const float progress = direction * (pose.theta - startTheta);
+        distTraveled = std::fabs(pose.theta - startTheta);
+        const ProfileState state = profile.sample((pros::millis() - startTime) / 1000.0);
+        profileDone = state.time >= profile.getDuration();
+
+        // motion chaining
+        if (params.minSpeed != 0 && progress >= std::fabs(angle) - params.earlyExitRange) break;
+
+        // update exit conditions
+        const float deltaTheta = direction * (std::fabs(angle) - progress);
+        angularLargeExit.update(deltaTheta);
+        angularSmallExit.update(deltaTheta, getLocalSpeed().theta);
+
+        // the moving side follows the profile. The lateral feedforward is used since it is the speed of the wheel
+        // that matters, the gyro rate tracks the profile velocity, and PID corrects for errors in following it
+        const float wheelVelocity = degToRad(state.velocity) * drivetrain.trackWidth;
+        const float wheelAcceleration = degToRad(state.acceleration) * drivetrain.trackWidth;
+        const float feedforward = lateral.kS * (state.velocity > 0) + lateral.kV * wheelVelocity +
+                                  lateral.kA * wheelAcceleration +
+                                  settings.kVelocity * (state.velocity - direction * getLocalSpeed().theta);
+        float motorPower = direction * (feedforward + angularPID.update(state.position - progress));
+        motorPower = std::clamp(motorPower, float(-params.maxSpeed), float(params.maxSpeed));
+
+        // the locked side is held where it started by driving it back along the heading
+        const Pose locked = lockedPoint(pose);
+        const float heading = degToRad(pose.theta);
+        const float lockedError = (lockedStart.x - locked.x) * sin(heading) + (lockedStart.y - locked.y) * cos(heading);
+        const float lockedPower = std::clamp(lateralPID.update(lockedError), -127.0f, 127.0f);
+
+        infoSink()->debug("Profile Angle: {}, Progress: {}, Swing Motor Power: {}, Locked Error: {}", state.position,
+                          progress, motorPower, lockedError);
+
+        // move the drivetrain
+        if (lockedSide == DriveSide::LEFT) {
+            setDrivePower(lockedPower, -motorPower);
+            if (checkStall(0, -motorPower)) break;
+        } else {
+            setDrivePower(motorPower, lockedPower);
+            if (checkStall(motorPower, 0)) break;
+        }
+
+        pros::delay(10);
+    }
+
+    // stop the drivetrain
+    setDrivePower(0, 0, true);
+    applyStallAction();
     // set distTraveled to -1 to indicate that the function has finished
     distTraveled = -1;
     this->endMotion();
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #include <cmath>
 #include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
 #include "lemlib/logger/logger.hpp"
 #include "lemlib/timer.hpp"
 #include "lemlib/util.hpp"
@@ -18,6 +19,14 @@ void lemlib::Chassis::swingToPoint(float x, float y, DriveSide lockedSide, int t
         pros::delay(10); // delay to give the task time to start
         return;
     }
+    if (params.profiled) {
+        const Pose pose = getPose();
+        float theta = radToDeg(M_PI_2 - atan2(y - pose.y, x - pose.x));
+        if (!params.forwards) theta += 180;
+        swingToHeadingProfiled(theta, lockedSide, timeout,
+                               {params.direction, params.maxSpeed, params.minSpeed, params.earlyExitRange});
+        return;
+    }
     float targetTheta;
     float deltaX, deltaY, deltaTheta;
     float motorPower;
@@ -33,9 +42,8 @@ void lemlib::Chassis::swingToPoint(float x, float y, DriveSide lockedSide, int t
     angularSmallExit.reset();
     angularPID.reset();
     // get original braking mode of that side of the drivetrain so we can set it back to it after this motion ends
-    pros::MotorBrake brakeMode = (lockedSide == DriveSide::LEFT)
-                                     ? this->drivetrain.leftMotors->get_brake_mode_all().at(0)
-                                     : this->drivetrain.rightMotors->get_brake_mode_all().at(0);
+    pros::MotorBrake brakeMode = (lockedSide == DriveSide::LEFT) ? this->drivetrain.leftMotors->get_brake_mode()
+                                                                 : this->drivetrain.rightMotors->get_brake_mode();
     // set brake mode of the locked side to hold
     if (lockedSide == DriveSide::LEFT) this->drivetrain.leftMotors->set_brake_mode_all(pros::E_MOTOR_BRAKE_HOLD);
     else this->drivetrain.rightMotors->set_brake_mode_all(pros::E_MOTOR_BRAKE_HOLD);
@@ -69,9 +77,10 @@ void lemlib::Chassis::swingToPoint(float x, float y, DriveSide lockedSide, int t
         if (params.minSpeed != 0 && sgn(deltaTheta) != sgn(prevDeltaTheta)) break;
 
         // calculate the speed
-        motorPower = angularPID.update(deltaTheta);
+        // pose.theta wraps around, so the continuous heading is used as the measurement
+        motorPower = angularPID.update(deltaTheta, 0, getPose().theta);
         angularLargeExit.update(deltaTheta);
-        angularSmallExit.update(deltaTheta);
+        angularSmallExit.update(deltaTheta, getLocalSpeed().theta);
 
         // cap the speed
         if (motorPower > params.maxSpeed) motorPower = params.maxSpeed;
@@ -85,12 +94,14 @@ void lemlib::Chassis::swingToPoint(float x, float y, DriveSide lockedSide, int t
 
         // move the drivetrain
         if (lockedSide == DriveSide::LEFT) {
-            drivetrain.rightMotors->move(-motorPower);
+            drivetrain.rightMotors->move_voltage(powerToVoltage(-motorPower));
             drivetrain.leftMotors->brake();
         } else {
-            drivetrain.leftMotors->move(motorPower);
+            drivetrain.leftMotors->move_voltage(powerToVoltage(motorPower));
             drivetrain.rightMotors->brake();
         }
+        invalidateDriveOutput();
+        if (lockedSide == DriveSide::LEFT ? checkStall(0, -motorPower) : checkStall(motorPower, 0)) break;
 
         pros::delay(10);
     }
@@ -100,8 +111,8 @@ void lemlib::Chassis::swingToPoint(float x, float y, DriveSide lockedSide, int t
     if (lockedSide == DriveSide::LEFT) this->drivetrain.leftMotors->set_brake_mode_all(brakeMode);
     else this->drivetrain.rightMotors->set_brake_mode_all(brakeMode);
     // stop the drivetrain
-    drivetrain.leftMotors->move(0);
-    drivetrain.rightMotors->move(0);
+    setDrivePower(0, 0, true);
+    applyStallAction();
     // set distTraveled to -1 to indicate that the function has finished
     distTraveled = -1;
     this->endMotion();
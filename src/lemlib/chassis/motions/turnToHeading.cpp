@@ -1,6 +1,8 @@
 #include <cmath>
 #include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
 #include "lemlib/logger/logger.hpp"
+#include "lemlib/motionProfile.hpp"
 #include "lemlib/timer.hpp"
 #include "lemlib/util.hpp"
 #include "pros/misc.hpp"
@@ -17,6 +19,10 @@ void lemlib::Chassis::turnToHeading(float theta, int timeout, TurnToHeadingParam
         pros::delay(10); // delay to give the task time to start
         return;
     }
+    if (params.profiled) {
+        turnToHeadingProfiled(theta, timeout, params);
+        return;
+    }
     float targetTheta;
     float deltaTheta;
     float motorPower;
@@ -58,9 +64,9 @@ void lemlib::Chassis::turnToHeading(float theta, int timeout, TurnToHeadingParam
         if (params.minSpeed != 0 && sgn(deltaTheta) != sgn(prevDeltaTheta)) break;
 
         // calculate the speed
-        motorPower = angularPID.update(deltaTheta);
+        motorPower = angularPID.update(deltaTheta, 0, pose.theta);
         angularLargeExit.update(deltaTheta);
-        angularSmallExit.update(deltaTheta);
+        angularSmallExit.update(deltaTheta, getLocalSpeed().theta);
 
         // cap the speed
         if (motorPower > params.maxSpeed) motorPower = params.maxSpeed;
@@ -73,16 +79,80 @@ void lemlib::Chassis::turnToHeading(float theta, int timeout, TurnToHeadingParam
         infoSink()->debug("Turn Motor Power: {} ", motorPower);
 
         // move the drivetrain
-        drivetrain.leftMotors->move(motorPower);
-        drivetrain.rightMotors->move(-motorPower);
+        setDriveOutput(0, motorPower);
+        if (checkStall(motorPower, -motorPower)) break;
+
+        pros::delay(10);
+    }
+
+    // stop the drivetrain
+    setDrivePower(0, 0, true);
+    applyStallAction();
+    // set distTraveled to -1 to indicate that the function has finished
+    distTraveled = -1;
+    this->endMotion();
+}
+
+void lemlib::Chassis::turnToHeadingProfiled(float theta, int timeout, TurnToHeadingParams params) {
+    distTraveled = 0;
+    Timer timer(timeout);
+    angularLargeExit.reset();
+    angularSmallExit.reset();
+    angularPID.reset();
+
+    // plan the profile for the whole turn, starting from the current angular velocity
+    const float startTheta = getPose().theta;
+    const float angle = angleError(theta, startTheta, false, params.direction);
+    const float direction = sgn(angle);
+    const ProfileSettings settings = getProfileSettings(Axis::ANGULAR);
+    const float maxVelocity = settings.maxVelocity * std::abs(params.maxSpeed) / 127;
+    const float endVelocity = settings.maxVelocity * std::abs(params.minSpeed) / 127;
+    const MotionProfile profile(std::fabs(angle), maxVelocity, settings.maxAcceleration, settings.maxJerk,
+                                direction * getLocalSpeed().theta, endVelocity);
+    const std::uint32_t startTime = pros::millis();
+
+    // main loop
+    // the profile has to finish before the exit conditions are checked
+    bool profileDone = false;
+    while (!timer.isDone() && ((!angularLargeExit.getExit() && !angularSmallExit.getExit()) || !profileDone) &&
+           this->motionRunning) {
+        // the heading is continuous, so it can be compared to the profile directly
+        const float heading = getPose().theta;
+        const float progress = direction * (heading - startTheta);
+        distTraveled = std::fabs(heading - startTheta);
+        const ProfileState state = profile.sample((pros::millis() - startTime) / 1000.0);
+        profileDone = state.time >= profile.getDuration();
+
+        // motion chaining
+        if (params.minSpeed != 0 && progress >= std::fabs(angle) - params.earlyExitRange) break;
+
+        // update exit conditions
+        const float deltaTheta = direction * (std::fabs(angle) - progress);
+        angularLargeExit.update(deltaTheta);
+        angularSmallExit.update(deltaTheta, getLocalSpeed().theta);
+
+        // feedforward from the profile, the gyro rate to track its velocity, and PID to correct for errors in
+        // following it
+        const float feedforward = settings.kS * (state.velocity > 0) + settings.kV * state.velocity +
+                                  settings.kA * state.acceleration +
+                                  settings.kVelocity * (state.velocity - direction * getLocalSpeed().theta);
+        float motorPower = direction * (feedforward + angularPID.update(state.position - progress));
+        motorPower = std::clamp(motorPower, float(-params.maxSpeed), float(params.maxSpeed));
+
+        infoSink()->debug("Profile Angle: {}, Progress: {}, Turn Motor Power: {}", state.position, progress,
+                          motorPower);
+
+        // move the drivetrain
+        setDriveOutput(0, motorPower);
+        if (checkStall(motorPower, -motorPower)) break;
 
         pros::delay(10);
     }
 
     // stop the drivetrain
-    drivetrain.leftMotors->move(0);
-    drivetrain.rightMotors->move(0);
+    setDrivePower(0, 0, true);
+    applyStallAction();
     // set distTraveled to -1 to indicate that the function has finished
     distTraveled = -1;
     this->endMotion();
-}
\ No newline at end of file
+}
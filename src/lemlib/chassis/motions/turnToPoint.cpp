@@ -1,5 +1,6 @@
 #include <cmath>
 #include "lemlib/chassis/chassis.hpp"
+#include "lemlib/chassis/odom.hpp"
 #include "lemlib/logger/logger.hpp"
 #include "lemlib/timer.hpp"
 #include "lemlib/util.hpp"
@@ -17,6 +18,14 @@ void lemlib::Chassis::turnToPoint(float x, float y, int timeout, TurnToPointPara
         pros::delay(10); // delay to give the task time to start
         return;
     }
+    if (params.profiled) {
+        const Pose pose = getPose();
+        float theta = radToDeg(M_PI_2 - atan2(y - pose.y, x - pose.x));
+        if (!params.forwards) theta += 180;
+        turnToHeadingProfiled(theta, timeout,
+                              {params.direction, params.maxSpeed, params.minSpeed, params.earlyExitRange});
+        return;
+    }
     float targetTheta;
     float deltaX, deltaY, deltaTheta;
     float motorPower;
@@ -61,9 +70,10 @@ void lemlib::Chassis::turnToPoint(float x, float y, int timeout, TurnToPointPara
         if (params.minSpeed != 0 && sgn(deltaTheta) != sgn(prevDeltaTheta)) break;
 
         // calculate the speed
-        motorPower = angularPID.update(deltaTheta);
+        // pose.theta wraps around, so the continuous heading is used as the measurement
+        motorPower = angularPID.update(deltaTheta, 0, getPose().theta);
         angularLargeExit.update(deltaTheta);
-        angularSmallExit.update(deltaTheta);
+        angularSmallExit.update(deltaTheta, getLocalSpeed().theta);
 
         // cap the speed
         if (motorPower > params.maxSpeed) motorPower = params.maxSpeed;
@@ -76,15 +86,15 @@ void lemlib::Chassis::turnToPoint(float x, float y, int timeout, TurnToPointPara
         infoSink()->debug("Turn Motor Power: {} ", motorPower);
 
         // move the drivetrain
-        drivetrain.leftMotors->move(motorPower);
-        drivetrain.rightMotors->move(-motorPower);
+        setDriveOutput(0, motorPower);
+        if (checkStall(motorPower, -motorPower)) break;
 
         pros::delay(10);
     }
 
     // stop the drivetrain
-    drivetrain.leftMotors->move(0);
-    drivetrain.rightMotors->move(0);
+    setDrivePower(0, 0, true);
+    applyStallAction();
     // set distTraveled to -1 to indicate that the function has finished
     distTraveled = -1;
     this->endMotion();
@@ -4,8 +4,14 @@
 // http://thepilons.ca/wp-content/uploads/2018/10/Tracking.pdf
 
 #include <math.h>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
 #include "pros/rtos.hpp"
 #include "lemlib/util.hpp"
+#include "lemlib/logger/logger.hpp"
 #include "lemlib/chassis/odom.hpp"
 #include "lemlib/chassis/chassis.hpp"
 #include "lemlib/chassis/trackingWheel.hpp"
@@ -16,23 +22,200 @@ pros::Task* trackingTask = nullptr;
 // global variables
 lemlib::OdomSensors odomSensors(nullptr, nullptr, nullptr, nullptr, nullptr); // the sensors to be used for odometry
 lemlib::Drivetrain drive(nullptr, nullptr, 0, 0, 0, 0); // the drivetrain to be used for odometry
+lemlib::OdomSettings odomSettings; // settings for the odometry task
 lemlib::Pose odomPose(0, 0, 0); // the pose of the robot
 lemlib::Pose odomSpeed(0, 0, 0); // the speed of the robot
 lemlib::Pose odomLocalSpeed(0, 0, 0); // the local speed of the robot
+lemlib::WheelSlip odomSlip; // the slip of each side of the drivetrain
 
-float prevVertical = 0;
-float prevVertical1 = 0;
-float prevVertical2 = 0;
-float prevHorizontal = 0;
-float prevHorizontal1 = 0;
-float prevHorizontal2 = 0;
-float prevImu = 0;
+std::uint32_t prevUpdateTime = 0; // time of the last update, in microseconds
 
-void lemlib::setSensors(lemlib::OdomSensors sensors, lemlib::Drivetrain drivetrain) {
+// how long a sensor can stay frozen while the robot is moving before it's considered disconnected, in milliseconds
+constexpr std::uint32_t FROZEN_TIME = 300;
+// how long a failed sensor has to behave before it's trusted again, in milliseconds
+constexpr std::uint32_t RECOVERY_TIME = 500;
+// minimum speed of the drivetrain for a sensor to be expected to change, in inches per second
+constexpr float FROZEN_SPEED = 8;
+// minimum angular speed of the drivetrain for the IMU to be expected to change, in radians per second
+constexpr float FROZEN_ANGULAR_SPEED = 0.5;
+// speeds below this are treated as this when calculating slip ratios, in inches per second
+constexpr float SLIP_MIN_SPEED = 5;
+// accelerations below this are treated as this when calculating slip from the IMU, in inches per second squared
+constexpr float SLIP_MIN_ACCEL = 40;
+// standard gravity, in inches per second squared
+constexpr float GRAVITY = 386.09;
+
+// how much the IMU has to turn before its scale factor is estimated, in radians
+constexpr float SCALE_MIN_ROTATION = 2 * M_PI;
+// largest scale factor error the estimate is allowed to correct
+constexpr float SCALE_MAX_ERROR = 0.05;
+// how much the IMU has to turn before the sign of its gyro rate is trusted, in radians
+constexpr float GYRO_MIN_ROTATION = 0.5;
+
+// how fast the robot can be moving while being considered stationary, in inches per second
+constexpr float STATIONARY_SPEED = 0.2;
+// how long the robot has to be stationary before the drift of the IMUs is measured, in milliseconds
+constexpr std::uint32_t STATIONARY_TIME = 500;
+// largest drift rate the bias estimate is allowed to correct, in radians per second
+constexpr float MAX_IMU_BIAS = 0.01;
+// how much IMUs can disagree with each other before being rejected, in radians per second
+constexpr float IMU_AGREEMENT_RATE = 0.2;
+// how much IMUs can disagree with each other before being rejected, as a fraction of the change in heading
+constexpr float IMU_AGREEMENT_RATIO = 0.1;
+
+// how many inches are in a meter, used to convert GPS readings
+constexpr float METERS_TO_INCHES = 39.3701;
+// GPS readings further from odometry than this many times the RMS error reported by the GPS are rejected
+constexpr float GPS_GATE_SIGMA = 4;
+// GPS readings closer to odometry than this are never rejected, in inches
+constexpr float GPS_GATE_MIN = 3;
+// if the GPS is rejected for this long, odometry is assumed to be wrong instead, in milliseconds
+constexpr std::uint32_t GPS_REJECT_TIME = 1000;
+// how many poses are kept to compensate for GPS latency. 100 is 1 second when odometry updates every 10ms
+constexpr int POSE_HISTORY_SIZE = 100;
+
+// state of the heading fusion filter
+float fusedHeading = 0; // fused heading, relative to when odometry started
+float imuHeading = 0; // heading from the IMU, corrected for scale factor error
+float imuScale = 1; // estimated IMU scale factor
+float scaleNumerator = 0; // least squares sums used to estimate the IMU scale factor
+float scaleDenominator = 0;
+float scaleRotation = 0; // how far the IMU has turned while the scale factor was being estimated
+float stationaryTime = 0; // how long the robot has been stationary, in milliseconds
+
+/**
+ * @brief A pose and when odometry calculated it
+ */
+struct PoseSample {
+        std::uint32_t time = 0; // in milliseconds
+        lemlib::Pose pose = lemlib::Pose(0, 0, 0);
+};
+
+// ring buffer of recent poses, used to find where the robot was when a GPS reading was taken
+std::array<PoseSample, POSE_HISTORY_SIZE> poseHistory;
+int poseHistoryIndex = 0; // where the next pose is written
+int poseHistoryCount = 0; // how many poses have been written, up to the size of the buffer
+
+std::uint32_t prevGpsTime = 0; // when the GPS was last fused, in milliseconds
+std::uint32_t gpsRejectTime = 0; // how long the GPS has been rejected for, in milliseconds
+
+float prevDriveLeftSpeed = 0; // speed of the left side of the drivetrain last update
+float prevDriveRightSpeed = 0; // speed of the right side of the drivetrain last update
+
+/**
+ * @brief A sensor used for odometry, and the state used to monitor its health
+ */
+struct OdomSource {
+        std::string name;
+        lemlib::TrackingWheel* wheel = nullptr; // the tracking wheel, if this sensor is a tracking wheel
+        pros::Imu* imu = nullptr; // the IMU, if this sensor is an IMU
+        float prev = 0; // last valid value of the sensor
+        float delta = 0; // change in the sensor value since the last update. NaN if the sensor returned an error
+        bool healthy = true; // false once the sensor has failed, until it recovers
+        bool usable = false; // whether the sensor can be used this update
+        float frozenTime = 0; // how long the sensor hasn't changed while it should have, in milliseconds
+        float goodTime = 0; // how long a failed sensor has been behaving, in milliseconds
+        float bias = 0; // estimated drift rate of the IMU, in radians per second
+        float gyroCorrelation = 0; // correlation between the gyro rate and the IMU rotation, used to find its direction
+};
+
+OdomSource vertical1Source {"vertical tracking wheel 1"};
+OdomSource vertical2Source {"vertical tracking wheel 2"};
+OdomSource horizontal1Source {"horizontal tracking wheel 1"};
+OdomSource horizontal2Source {"horizontal tracking wheel 2"};
+// every IMU is monitored on its own, and the IMUs that agree with each other are combined into a single source
+std::vector<OdomSource> imuSources;
+OdomSource imuSource {"IMU"};
+// IMUs given to odometry while it's running, which are switched to at the start of the next update. They're handed
+// over from another task, so they're protected by a mutex
+pros::Mutex imuMutex;
+std::vector<pros::Imu*> pendingImus;
+bool imusPending = false;
+// the drivetrain motor encoders are used as a reference to check the other sensors against,
+// and as the last resort if every other sensor fails
+OdomSource driveLeftSource {"left drivetrain motors"};
+OdomSource driveRightSource {"right drivetrain motors"};
+
+/**
+ * @brief Compensated (Kahan) sum
+ *
+ * Adding thousands of small displacements to a large position loses the low bits of every displacement. This keeps
+ * track of the lost bits and adds them back in the next time
+ */
+struct KahanSum {
+        double sum = 0;
+        double compensation = 0;
+
+        void add(double value) {
+            const double y = value - compensation;
+            const double t = sum + y;
+            compensation = (t - sum) - y;
+            sum = t;
+        }
+
+        void set(double value) {
+            sum = value;
+            compensation = 0;
+        }
+};
+
+// double precision pose used by OdomIntegration::EXACT
+KahanSum exactX;
+KahanSum exactY;
+KahanSum exactTheta;
+
+/**
+ * @brief Create the odometry sources for a list of IMUs
+ *
+ * @param imus the IMUs
+ */
+void buildImuSources(const std::vector<pros::Imu*>& imus) {
+    imuSources.clear();
+    for (pros::Imu* imu : imus) {
+        OdomSource source {imus.size() == 1 ? "IMU" : "IMU on port " + std::to_string(imu->get_port())};
+        source.imu = imu;
+        imuSources.push_back(source);
+    }
+}
+
+void lemlib::setSensors(lemlib::OdomSensors sensors, lemlib::Drivetrain drivetrain, lemlib::OdomSettings settings) {
     odomSensors = sensors;
     drive = drivetrain;
+    odomSettings = settings;
+    // V5 smart sensors can't send data faster than every 5ms
+    odomSettings.rate = std::max(odomSettings.rate, std::uint32_t(5));
+    odomSettings.gpsRate = std::max(odomSettings.gpsRate, std::uint32_t(5));
+    vertical1Source.wheel = sensors.vertical1;
+    vertical2Source.wheel = sensors.vertical2;
+    horizontal1Source.wheel = sensors.horizontal1;
+    horizontal2Source.wheel = sensors.horizontal2;
+    imuMutex.take();
+    imusPending = false;
+    imuMutex.give();
+    buildImuSources(sensors.imus);
+    // create the reference tracking wheels from the drivetrain
+    delete driveLeftSource.wheel;
+    delete driveRightSource.wheel;
+    driveLeftSource.wheel = nullptr;
+    driveRightSource.wheel = nullptr;
+    if (drivetrain.leftMotors != nullptr && drivetrain.rightMotors != nullptr) {
+        driveLeftSource.wheel = new lemlib::TrackingWheel(drivetrain.leftMotors, drivetrain.wheelDiameter,
+                                                          -(drivetrain.trackWidth / 2), drivetrain.rpm);
+        driveRightSource.wheel = new lemlib::TrackingWheel(drivetrain.rightMotors, drivetrain.wheelDiameter,
+                                                           drivetrain.trackWidth / 2, drivetrain.rpm);
+    }
 }
 
+void lemlib::setImus(std::vector<pros::Imu*> imus) {
+    // the odometry task might be in the middle of an update, so the IMUs are switched to by the odometry task
+    imuMutex.take();
+    pendingImus = imus;
+    imusPending = true;
+    imuMutex.give();
+}
+
+std::uint32_t lemlib::getRate() { return odomSettings.rate; }
+
 lemlib::Pose lemlib::getPose(bool radians) {
     if (radians) return odomPose;
     else return lemlib::Pose(odomPose.x, odomPose.y, radToDeg(odomPose.theta));
@@ -41,6 +224,12 @@ lemlib::Pose lemlib::getPose(bool radians) {
 void lemlib::setPose(lemlib::Pose pose, bool radians) {
     if (radians) odomPose = pose;
     else odomPose = lemlib::Pose(pose.x, pose.y, degToRad(pose.theta));
+    exactX.set(odomPose.x);
+    exactY.set(odomPose.y);
+    exactTheta.set(odomPose.theta);
+    // the old poses are in a different frame now
+    poseHistoryCount = 0;
+    poseHistoryIndex = 0;
 }
 
 lemlib::Pose lemlib::getSpeed(bool radians) {
@@ -53,6 +242,8 @@ lemlib::Pose lemlib::getLocalSpeed(bool radians) {
     else return lemlib::Pose(odomLocalSpeed.x, odomLocalSpeed.y, radToDeg(odomLocalSpeed.theta));
 }
 
+lemlib::WheelSlip lemlib::getSlip() { return odomSlip; }
+
 lemlib::Pose lemlib::estimatePose(float time, bool radians) {
     // get current position and speed
     Pose curPose = getPose(true);
@@ -72,33 +263,465 @@ lemlib::Pose lemlib::estimatePose(float time, bool radians) {
     return futurePose;
 }
 
+/**
+ * @brief Integrate a change in local position using the exact SE(2) exponential map
+ *
+ * Assuming constant velocity over the update, the robot moves along an arc. The exponential map is the same
+ * chord-of-the-arc calculation the arc approximation does, but it's evaluated in double precision with a series
+ * expansion for small angles (instead of skipping the arc when the heading doesn't change at all), and the global
+ * pose is accumulated with compensated summation
+ *
+ * @param deltaX change in horizontal tracking wheel distance
+ * @param deltaY change in vertical tracking wheel distance
+ * @param deltaHeading change in heading, in radians
+ * @param horizontalOffset offset of the horizontal tracking wheel
+ * @param verticalOffset offset of the vertical tracking wheel
+ */
+void integrateExact(double deltaX, double deltaY, double deltaHeading, double horizontalOffset,
+                    double verticalOffset) {
+    // displacement of the tracking center. Tracking wheels that aren't at the center also move when the robot turns
+    const double centerX = deltaX + horizontalOffset * deltaHeading;
+    const double centerY = deltaY + verticalOffset * deltaHeading;
+    // the chord of the arc is the displacement scaled by sinc(deltaHeading / 2), pointing along the average heading
+    const double halfAngle = deltaHeading / 2;
+    const double scale =
+        std::fabs(halfAngle) < 1e-4 ? 1 - halfAngle * halfAngle / 6 : std::sin(halfAngle) / halfAngle;
+    const double localX = centerX * scale;
+    const double localY = centerY * scale;
+    const double avgHeading = exactTheta.sum + halfAngle;
+    const double sinHeading = std::sin(avgHeading);
+    const double cosHeading = std::cos(avgHeading);
+    exactX.add(localY * sinHeading - localX * cosHeading);
+    exactY.add(localY * cosHeading + localX * sinHeading);
+    exactTheta.add(deltaHeading);
+    odomPose = lemlib::Pose(exactX.sum, exactY.sum, exactTheta.sum);
+}
+
+/**
+ * @brief Integrate one odometry update with the single precision arc approximation (OdomIntegration::ARC)
+ *
+ * @param deltaX change in horizontal tracking wheel distance
+ * @param deltaY change in vertical tracking wheel distance
+ * @param deltaHeading change in heading, in radians
+ * @param horizontalOffset offset of the horizontal tracking wheel
+ * @param verticalOffset offset of the vertical tracking wheel
+ */
+void integrateArc(float deltaX, float deltaY, float deltaHeading, float horizontalOffset, float verticalOffset) {
+    const float avgHeading = odomPose.theta + deltaHeading / 2;
+    // calculate local x and y
+    float localX = 0;
+    float localY = 0;
+    if (deltaHeading == 0) { // prevent divide by 0
+        localX = deltaX;
+        localY = deltaY;
+    } else {
+        localX = 2 * sin(deltaHeading / 2) * (deltaX / deltaHeading + horizontalOffset);
+        localY = 2 * sin(deltaHeading / 2) * (deltaY / deltaHeading + verticalOffset);
+    }
+
+    // calculate global x and y
+    odomPose.x += localY * sin(avgHeading);
+    odomPose.y += localY * cos(avgHeading);
+    odomPose.x += localX * -cos(avgHeading);
+    odomPose.y += localX * sin(avgHeading);
+    odomPose.theta += deltaHeading;
+}
+
+/**
+ * @brief Read the value of an odometry sensor
+ *
+ * @param source the sensor to read
+ */
+void readSource(OdomSource& source) {
+    source.usable = false;
+    float value = 0;
+    if (source.wheel != nullptr) value = source.wheel->getDistanceTraveled();
+    else if (source.imu != nullptr) value = lemlib::degToRad(source.imu->get_rotation());
+    else return; // the sensor doesn't exist
+    // delta is NaN if the sensor returned an error, which the health check catches
+    source.delta = value - source.prev;
+    if (std::isfinite(value)) source.prev = value;
+    source.usable = true;
+}
+
+/**
+ * @brief Check the health of an odometry sensor
+ *
+ * A sensor fails if it returns an error, if it changes by an implausible amount, or if it stops changing while the
+ * drivetrain says it should be moving. Failing is logged, and the sensor won't be used until it has behaved for a
+ * while. The frozen check can be tripped by the drivetrain wheels slipping while pushing, but the sensor recovers as
+ * soon as it starts moving again
+ *
+ * @param source the sensor to check
+ * @param maxDelta largest plausible change since the last update. No limit if set to 0
+ * @param expectMotion whether the drivetrain says this sensor should be changing
+ * @param dt time since the last update, in seconds
+ */
+void checkSource(OdomSource& source, float maxDelta, bool expectMotion, float dt) {
+    if (!source.usable) return; // the sensor doesn't exist
+    const char* problem = nullptr;
+    if (!std::isfinite(source.delta)) {
+        problem = "returned an error";
+    } else if (maxDelta != 0 && std::fabs(source.delta) > maxDelta) {
+        problem = "changed by an implausible amount";
+    } else if (source.delta == 0 && expectMotion) {
+        source.frozenTime += dt * 1000;
+        if (source.frozenTime >= FROZEN_TIME) problem = "stopped changing while the robot is moving";
+    } else {
+        source.frozenTime = 0;
+    }
+
+    if (problem != nullptr) {
+        if (source.healthy)
+            lemlib::infoSink()->error("Odometry: {} {}! Switching to the next best sensor", source.name, problem);
+        source.healthy = false;
+        source.goodTime = 0;
+    } else if (!source.healthy) {
+        source.goodTime += dt * 1000;
+        if (source.goodTime >= RECOVERY_TIME) {
+            lemlib::infoSink()->warn("Odometry: {} has recovered", source.name);
+            source.healthy = true;
+            source.frozenTime = 0;
+        }
+    }
+    source.usable = source.healthy && problem == nullptr;
+}
+
+/**
+ * @brief Calculate the slip ratio of a side of the drivetrain from its speed and its speed over the ground
+ *
+ * @param wheelSpeed speed of the wheels
+ * @param groundSpeed speed over the ground
+ * @return float slip ratio. Positive if the wheels spin faster than the ground moves, negative if slower
+ */
+float slipRatio(float wheelSpeed, float groundSpeed) {
+    const float reference = std::max({std::fabs(wheelSpeed), std::fabs(groundSpeed), SLIP_MIN_SPEED});
+    return lemlib::sgn(wheelSpeed) * (wheelSpeed - groundSpeed) / reference;
+}
+
+/**
+ * @brief Update the estimated slip of each side of the drivetrain
+ *
+ * If there is an unpowered tracking wheel, the speed of each side of the drivetrain is compared to the speed it moves
+ * over the ground according to the tracking wheels. Otherwise, the acceleration of each side is compared to the
+ * acceleration the IMU measures, which catches wheelspin under hard acceleration but can't see slow skids
+ *
+ * @param groundSpeed forward speed of the tracking center over the ground
+ * @param angularSpeed angular speed of the robot
+ * @param groundReference whether groundSpeed and angularSpeed are independent of the drivetrain encoders
+ * @param dt time since the last update, in seconds
+ */
+void updateSlip(float groundSpeed, float angularSpeed, bool groundReference, float dt) {
+    if (!driveLeftSource.usable || !driveRightSource.usable) {
+        odomSlip = lemlib::WheelSlip();
+        return;
+    }
+    const float leftSpeed = driveLeftSource.wheel->getVelocity();
+    const float rightSpeed = driveRightSource.wheel->getVelocity();
+    if (!std::isfinite(leftSpeed) || !std::isfinite(rightSpeed)) return;
+    float leftSlip = 0;
+    float rightSlip = 0;
+    if (groundReference) {
+        // speed of each side of the drivetrain over the ground
+        const float leftGround = groundSpeed + drive.trackWidth / 2 * angularSpeed;
+        const float rightGround = groundSpeed - drive.trackWidth / 2 * angularSpeed;
+        leftSlip = slipRatio(leftSpeed, leftGround);
+        rightSlip = slipRatio(rightSpeed, rightGround);
+    } else if (imuSource.usable) {
+        // the mounting orientation of the IMU isn't known, so only the magnitude of the horizontal acceleration is used
+        const pros::imu_accel_s_t accel = imuSource.imu->get_accel();
+        const float imuAccel = std::hypot(accel.x, accel.y) * GRAVITY;
+        const float leftAccel = std::fabs(leftSpeed - prevDriveLeftSpeed) / dt;
+        const float rightAccel = std::fabs(rightSpeed - prevDriveRightSpeed) / dt;
+        if (std::isfinite(imuAccel)) {
+            leftSlip = (leftAccel - imuAccel) / std::max({leftAccel, imuAccel, SLIP_MIN_ACCEL});
+            rightSlip = (rightAccel - imuAccel) / std::max({rightAccel, imuAccel, SLIP_MIN_ACCEL});
+        }
+    }
+    prevDriveLeftSpeed = leftSpeed;
+    prevDriveRightSpeed = rightSpeed;
+    // the motor velocity is noisy, so smooth the slip
+    odomSlip.left = lemlib::ema(leftSlip, odomSlip.left, 0.5);
+    odomSlip.right = lemlib::ema(rightSlip, odomSlip.right, 0.5);
+}
+
+/**
+ * @brief Fuse the IMU and the tracking wheels into a single change in heading
+ *
+ * This is a complementary filter. The change in heading is predicted with a low latency source: unpowered tracking
+ * wheels if there are any, else the gyro rate of the IMU. The prediction is then pulled towards the heading reported
+ * by the IMU, which doesn't drift from wheel slip, with the time constant set in the odometry settings.
+ *
+ * If there are unpowered tracking wheels, the scale factor of the IMU is also estimated against them while turning
+ *
+ * @param wheelDelta change in heading measured by unpowered tracking wheels. NaN if there aren't any
+ * @param dt time since the last update, in seconds
+ * @return float the fused change in heading
+ */
+float fuseHeading(float wheelDelta, float dt) {
+    const bool wheelsUsable = std::isfinite(wheelDelta);
+    // estimate the scale factor of the IMU while turning
+    if (odomSettings.estimateImuScale && wheelsUsable && std::fabs(imuSource.delta) > FROZEN_ANGULAR_SPEED * dt) {
+        scaleNumerator += wheelDelta * imuSource.delta;
+        scaleDenominator += imuSource.delta * imuSource.delta;
+        scaleRotation += std::fabs(imuSource.delta);
+        if (scaleRotation > SCALE_MIN_ROTATION)
+            imuScale = std::clamp(scaleNumerator / scaleDenominator, 1 - SCALE_MAX_ERROR, 1 + SCALE_MAX_ERROR);
+    }
+    const float imuDelta = imuSource.delta * imuScale;
+    imuHeading += imuDelta;
+
+    // the axis the gyro rate is measured around depends on how the IMU is mounted, so the direction of the gyro rate
+    // is learned by comparing it to the IMU rotation
+    // the gyro rates of all the IMUs that agree are averaged
+    float gyroSum = 0;
+    int gyroCount = 0;
+    for (OdomSource& source : imuSources) {
+        if (!source.usable) continue;
+        const pros::imu_gyro_s_t gyro = source.imu->get_gyro_rate();
+        if (!std::isfinite(gyro.z)) continue;
+        const float rate = lemlib::degToRad(gyro.z);
+        source.gyroCorrelation += lemlib::sgn(rate) * source.delta;
+        if (std::fabs(source.gyroCorrelation) < GYRO_MIN_ROTATION) continue;
+        gyroSum += rate * lemlib::sgn(source.gyroCorrelation) - source.bias;
+        gyroCount++;
+    }
+    const float gyroDelta = gyroCount != 0 ? gyroSum / gyroCount * dt * imuScale : NAN;
+
+    // predict the change in heading with the lowest latency source available
+    float prediction = imuDelta;
+    if (wheelsUsable) prediction = wheelDelta;
+    else if (std::isfinite(gyroDelta)) prediction = gyroDelta;
+
+    // pull the prediction towards the IMU heading
+    const float gain = dt / (odomSettings.headingTimeConstant + dt);
+    const float prevFusedHeading = fusedHeading;
+    fusedHeading += prediction;
+    fusedHeading += gain * (imuHeading - fusedHeading);
+    return fusedHeading - prevFusedHeading;
+}
+
+/**
+ * @brief Combine the IMUs into a single change in heading
+ *
+ * The drift of each IMU is measured while the robot is stationary and subtracted. IMUs that disagree with the rest are
+ * rejected: with 3 or more IMUs they are compared to the median, with 2 they are compared to the reference. The
+ * remaining IMUs are averaged, and marked as usable so their gyro rates can be averaged too
+ *
+ * @param referenceDelta change in heading measured by the drivetrain. NaN if it isn't available
+ * @param stationary whether the robot has been stationary long enough to measure the drift of the IMUs
+ * @param dt time since the last update, in seconds
+ */
+void combineImus(float referenceDelta, bool stationary, float dt) {
+    imuSource.usable = false;
+    imuSource.imu = nullptr;
+    std::vector<float> deltas;
+    for (OdomSource& source : imuSources) {
+        if (!source.usable) continue;
+        if (stationary) source.bias = std::clamp(lemlib::ema(source.delta / dt, source.bias, 0.02), -MAX_IMU_BIAS,
+                                                 MAX_IMU_BIAS);
+        source.delta -= source.bias * dt;
+        deltas.push_back(source.delta);
+    }
+    if (deltas.empty()) return;
+
+    // find what the IMUs should agree with
+    float center = deltas.front();
+    if (deltas.size() >= 3) {
+        std::nth_element(deltas.begin(), deltas.begin() + deltas.size() / 2, deltas.end());
+        center = deltas[deltas.size() / 2];
+    } else if (deltas.size() == 2) {
+        center = std::isfinite(referenceDelta) ? referenceDelta : (deltas[0] + deltas[1]) / 2;
+    }
+    const float tolerance = IMU_AGREEMENT_RATE * dt + IMU_AGREEMENT_RATIO * std::fabs(center);
+    auto agrees = [&](const OdomSource& source) { return std::fabs(source.delta - center) <= tolerance; };
+    // if no IMU agrees (e.g the drivetrain is slipping), they're all used
+    const bool anyAgree = std::any_of(imuSources.begin(), imuSources.end(),
+                                      [&](const OdomSource& source) { return source.usable && agrees(source); });
+
+    // average the IMUs that agree
+    float sum = 0;
+    int count = 0;
+    for (OdomSource& source : imuSources) {
+        if (!source.usable) continue;
+        if (anyAgree && !agrees(source)) {
+            source.usable = false;
+            continue;
+        }
+        if (imuSource.imu == nullptr) imuSource.imu = source.imu;
+        sum += source.delta;
+        count++;
+    }
+    imuSource.delta = sum / count;
+    imuSource.usable = true;
+}
+
+/**
+ * @brief Find where odometry thought the robot was at a given time
+ *
+ * @param time time in milliseconds
+ * @return lemlib::Pose pose interpolated from the pose history. The oldest pose if the time is too old, and the
+ * current pose if there isn't any history
+ */
+lemlib::Pose poseAt(std::uint32_t time) {
+    PoseSample newer {pros::millis(), odomPose};
+    for (int i = 0; i < poseHistoryCount; i++) {
+        const PoseSample& sample = poseHistory[(poseHistoryIndex - 1 - i + POSE_HISTORY_SIZE) % POSE_HISTORY_SIZE];
+        if (sample.time <= time) {
+            if (newer.time == sample.time) return sample.pose;
+            const float t = float(time - sample.time) / (newer.time - sample.time);
+            lemlib::Pose pose = sample.pose.lerp(newer.pose, t);
+            pose.theta = sample.pose.theta + (newer.pose.theta - sample.pose.theta) * t;
+            return pose;
+        }
+        newer = sample;
+    }
+    return newer.pose;
+}
+
+/**
+ * @brief Move the pose of the robot, and the pose history with it
+ *
+ * @param deltaX change in x, in inches
+ * @param deltaY change in y, in inches
+ * @param deltaTheta change in heading, in radians
+ */
+void shiftPose(float deltaX, float deltaY, float deltaTheta) {
+    odomPose.x += deltaX;
+    odomPose.y += deltaY;
+    odomPose.theta += deltaTheta;
+    exactX.add(deltaX);
+    exactY.add(deltaY);
+    exactTheta.add(deltaTheta);
+    // walk back from the newest sample, the same way poseAt does
+    for (int i = 0; i < poseHistoryCount; i++) {
+        PoseSample& sample = poseHistory[(poseHistoryIndex - 1 - i + POSE_HISTORY_SIZE) % POSE_HISTORY_SIZE];
+        sample.pose.x += deltaX;
+        sample.pose.y += deltaY;
+        sample.pose.theta += deltaTheta;
+    }
+}
+
+/**
+ * @brief Correct the pose of the robot with the GPS
+ *
+ * Readings are ignored while the GPS reports a large error, and rejected if they're too far from odometry, unless
+ * they have been for a while (e.g the robot got knocked). The GPS readings are delayed, so they're compared to where
+ * odometry thought the robot was when the reading was taken, and the pose is pulled by a fraction of the difference
+ */
+void fuseGps() {
+    pros::Gps* gps = odomSensors.gps;
+    if (gps == nullptr) return;
+    const std::uint32_t now = pros::millis();
+    if (prevGpsTime != 0 && now - prevGpsTime < odomSettings.gpsRate) return;
+    const float dt = prevGpsTime != 0 ? (now - prevGpsTime) / 1000.0 : odomSettings.gpsRate / 1000.0;
+    prevGpsTime = now;
+
+    // the GPS returns PROS_ERR_F (infinity) while it's calibrating or disconnected
+    const float error = gps->get_error() * METERS_TO_INCHES;
+    const pros::gps_position_s_t position = gps->get_position();
+    const float heading = lemlib::degToRad(gps->get_heading());
+    if (!std::isfinite(error) || !std::isfinite(position.x) || !std::isfinite(position.y) || !std::isfinite(heading))
+        return;
+    if (error > odomSettings.gpsMaxError) return;
+
+    // compare the reading to where the robot was when it was taken
+    const lemlib::Pose past = poseAt(now - std::uint32_t(odomSettings.gpsLatency * 1000));
+    const float deltaX = position.x * METERS_TO_INCHES - past.x;
+    const float deltaY = position.y * METERS_TO_INCHES - past.y;
+    const float deltaTheta = lemlib::angleError(heading, past.theta);
+    if (std::hypot(deltaX, deltaY) > std::max(GPS_GATE_SIGMA * error, GPS_GATE_MIN)) {
+        gpsRejectTime += dt * 1000;
+        if (gpsRejectTime < GPS_REJECT_TIME) return;
+    } else {
+        gpsRejectTime = 0;
+    }
+
+    const float gain = dt / (odomSettings.gpsTimeConstant + dt);
+    shiftPose(gain * deltaX, gain * deltaY, odomSettings.gpsHeading ? gain * deltaTheta : 0);
+}
+
+/**
+ * @brief Calculate the change in heading using a pair of parallel tracking wheels
+ */
+float pairDeltaHeading(const OdomSource& a, const OdomSource& b) {
+    return -(a.delta - b.delta) / (a.wheel->getOffset() - b.wheel->getOffset());
+}
+
 void lemlib::update() {
     // TODO: add particle filter
+    // measure the time since the last update
+    // fall back to the nominal rate on the first update, or if the timer misbehaves
+    const std::uint32_t now = pros::micros();
+    float dt = (now - prevUpdateTime) / 1000000.0;
+    if (prevUpdateTime == 0 || dt <= 0 || dt > 0.1) dt = odomSettings.rate / 1000.0;
+    prevUpdateTime = now;
+
+    // switch to new IMUs. They start measuring from their current rotation, so the heading doesn't jump
+    imuMutex.take();
+    const bool switchImus = imusPending;
+    if (switchImus) odomSensors.imus = pendingImus;
+    imusPending = false;
+    imuMutex.give();
+    if (switchImus) {
+        odomSensors.imu = odomSensors.imus.empty() ? nullptr : odomSensors.imus.front();
+        buildImuSources(odomSensors.imus);
+        for (OdomSource& source : imuSources) {
+            readSource(source);
+            source.imu->set_data_rate(odomSettings.rate);
+        }
+    }
+
     // get the current sensor values
-    float vertical1Raw = 0;
-    float vertical2Raw = 0;
-    float horizontal1Raw = 0;
-    float horizontal2Raw = 0;
-    float imuRaw = 0;
-    if (odomSensors.vertical1 != nullptr) vertical1Raw = odomSensors.vertical1->getDistanceTraveled();
-    if (odomSensors.vertical2 != nullptr) vertical2Raw = odomSensors.vertical2->getDistanceTraveled();
-    if (odomSensors.horizontal1 != nullptr) horizontal1Raw = odomSensors.horizontal1->getDistanceTraveled();
-    if (odomSensors.horizontal2 != nullptr) horizontal2Raw = odomSensors.horizontal2->getDistanceTraveled();
-    if (odomSensors.imu != nullptr) imuRaw = degToRad(odomSensors.imu->get_rotation());
-
-    // calculate the change in sensor values
-    float deltaVertical1 = vertical1Raw - prevVertical1;
-    float deltaVertical2 = vertical2Raw - prevVertical2;
-    float deltaHorizontal1 = horizontal1Raw - prevHorizontal1;
-    float deltaHorizontal2 = horizontal2Raw - prevHorizontal2;
-    float deltaImu = imuRaw - prevImu;
-
-    // update the previous sensor values
-    prevVertical1 = vertical1Raw;
-    prevVertical2 = vertical2Raw;
-    prevHorizontal1 = horizontal1Raw;
-    prevHorizontal2 = horizontal2Raw;
-    prevImu = imuRaw;
+    readSource(vertical1Source);
+    readSource(vertical2Source);
+    readSource(horizontal1Source);
+    readSource(horizontal2Source);
+    for (OdomSource& source : imuSources) readSource(source);
+    readSource(driveLeftSource);
+    readSource(driveRightSource);
+
+    // check the health of the drivetrain encoders first, since they're the reference for the other sensors
+    // the drivetrain can't report an implausible change of itself, so only errors are checked
+    checkSource(driveLeftSource, 0, false, dt);
+    checkSource(driveRightSource, 0, false, dt);
+    const bool driveUsable = driveLeftSource.usable && driveRightSource.usable && drive.rpm != 0;
+    float maxWheelDelta = 0; // largest plausible change of a tracking wheel
+    float maxImuDelta = 0; // largest plausible change of the IMU
+    bool driveMoving = false; // whether the drivetrain is moving forwards or backwards
+    bool driveTurning = false; // whether the drivetrain is turning
+    float driveDeltaHeading = 0;
+    if (driveUsable) {
+        // allow a full update at top speed on top of the motion of the drivetrain, in case the robot is being pushed
+        const float maxSpeed = drive.rpm * M_PI * drive.wheelDiameter / 60;
+        const float driveDelta = std::max(std::fabs(driveLeftSource.delta), std::fabs(driveRightSource.delta));
+        driveDeltaHeading = pairDeltaHeading(driveLeftSource, driveRightSource);
+        maxWheelDelta = 2 * driveDelta + maxSpeed * dt;
+        maxImuDelta = 2 * std::fabs(driveDeltaHeading) + 2 * maxSpeed / drive.trackWidth * dt;
+        driveMoving = std::fabs(driveLeftSource.delta + driveRightSource.delta) / 2 > FROZEN_SPEED * dt;
+        driveTurning = std::fabs(driveDeltaHeading) > FROZEN_ANGULAR_SPEED * dt;
+    }
+    // horizontal tracking wheels only move when the robot turns, unless the robot is pushed sideways
+    auto horizontalMoving = [&](const OdomSource& source) {
+        return driveUsable && std::fabs(source.wheel->getOffset() * driveDeltaHeading) > FROZEN_SPEED * dt;
+    };
+    checkSource(vertical1Source, maxWheelDelta, driveMoving, dt);
+    checkSource(vertical2Source, maxWheelDelta, driveMoving, dt);
+    if (horizontal1Source.usable)
+        checkSource(horizontal1Source, maxWheelDelta, horizontalMoving(horizontal1Source), dt);
+    if (horizontal2Source.usable)
+        checkSource(horizontal2Source, maxWheelDelta, horizontalMoving(horizontal2Source), dt);
+    for (OdomSource& source : imuSources) checkSource(source, maxImuDelta, driveTurning, dt);
+
+    // the robot is stationary if none of the wheels are moving
+    bool stationary = driveUsable;
+    for (const OdomSource* source :
+         {&vertical1Source, &vertical2Source, &horizontal1Source, &horizontal2Source, &driveLeftSource,
+          &driveRightSource}) {
+        if (source->usable && std::fabs(source->delta) > STATIONARY_SPEED * dt) stationary = false;
+    }
+    stationaryTime = stationary ? stationaryTime + dt * 1000 : 0;
+    combineImus(driveUsable ? driveDeltaHeading : NAN, stationaryTime >= STATIONARY_TIME, dt);
 
     // calculate the heading of the robot
     // Priority:
@@ -106,37 +729,55 @@ void lemlib::update() {
     // 2. Vertical tracking wheels
     // 3. Inertial Sensor
     // 4. Drivetrain
-    float heading = odomPose.theta;
+    // sensors that have failed are skipped, so the next best source is used in the same update
+    const bool verticalPowered = (vertical1Source.usable && vertical1Source.wheel->getType()) ||
+                                 (vertical2Source.usable && vertical2Source.wheel->getType());
+    float deltaHeading = 0;
+    bool headingFromDrive = false; // whether the heading depends on the drivetrain encoders
     // calculate the heading using the horizontal tracking wheels
-    if (odomSensors.horizontal1 != nullptr && odomSensors.horizontal2 != nullptr)
-        heading -= (deltaHorizontal1 - deltaHorizontal2) /
-                   (odomSensors.horizontal1->getOffset() - odomSensors.horizontal2->getOffset());
+    if (horizontal1Source.usable && horizontal2Source.usable)
+        deltaHeading = pairDeltaHeading(horizontal1Source, horizontal2Source);
     // else, if both vertical tracking wheels aren't substituted by the drivetrain, use the vertical tracking wheels
-    else if (!odomSensors.vertical1->getType() && !odomSensors.vertical2->getType())
-        heading -= (deltaVertical1 - deltaVertical2) /
-                   (odomSensors.vertical1->getOffset() - odomSensors.vertical2->getOffset());
+    else if (vertical1Source.usable && vertical2Source.usable && !verticalPowered)
+        deltaHeading = pairDeltaHeading(vertical1Source, vertical2Source);
     // else, if the inertial sensor exists, use it
-    else if (odomSensors.imu != nullptr) heading += deltaImu;
+    else if (imuSource.usable) deltaHeading = imuSource.delta;
     // else, use the the substituted tracking wheels
-    else
-        heading -= (deltaVertical1 - deltaVertical2) /
-                   (odomSensors.vertical1->getOffset() - odomSensors.vertical2->getOffset());
-    float deltaHeading = heading - odomPose.theta;
-    float avgHeading = odomPose.theta + deltaHeading / 2;
+    else if (vertical1Source.usable && vertical2Source.usable) {
+        deltaHeading = pairDeltaHeading(vertical1Source, vertical2Source);
+        headingFromDrive = true;
+    }
+    // else, use the drivetrain directly
+    else if (driveLeftSource.usable && driveRightSource.usable) {
+        deltaHeading = driveDeltaHeading;
+        headingFromDrive = true;
+    }
+    // combine the sensors if heading fusion is enabled
+    if (odomSettings.headingFusion == lemlib::HeadingFusion::COMPLEMENTARY && imuSource.usable) {
+        float wheelDelta = NAN;
+        if (horizontal1Source.usable && horizontal2Source.usable)
+            wheelDelta = pairDeltaHeading(horizontal1Source, horizontal2Source);
+        else if (vertical1Source.usable && vertical2Source.usable && !verticalPowered)
+            wheelDelta = pairDeltaHeading(vertical1Source, vertical2Source);
+        deltaHeading = fuseHeading(wheelDelta, dt);
+        headingFromDrive = false;
+    }
+    const float heading = odomPose.theta + deltaHeading;
 
     // choose tracking wheels to use
-    // Prioritize non-powered tracking wheels
-    lemlib::TrackingWheel* verticalWheel = nullptr;
-    lemlib::TrackingWheel* horizontalWheel = nullptr;
-    if (!odomSensors.vertical1->getType()) verticalWheel = odomSensors.vertical1;
-    else if (!odomSensors.vertical2->getType()) verticalWheel = odomSensors.vertical2;
-    else verticalWheel = odomSensors.vertical1;
-    if (odomSensors.horizontal1 != nullptr) horizontalWheel = odomSensors.horizontal1;
-    else if (odomSensors.horizontal2 != nullptr) horizontalWheel = odomSensors.horizontal2;
-    float rawVertical = 0;
-    float rawHorizontal = 0;
-    if (verticalWheel != nullptr) rawVertical = verticalWheel->getDistanceTraveled();
-    if (horizontalWheel != nullptr) rawHorizontal = horizontalWheel->getDistanceTraveled();
+    // Prioritize non-powered tracking wheels, then fall back to the drivetrain
+    OdomSource* verticalSource = nullptr;
+    OdomSource* horizontalSource = nullptr;
+    for (OdomSource* source : {&vertical1Source, &vertical2Source}) {
+        if (verticalSource == nullptr && source->usable && !source->wheel->getType()) verticalSource = source;
+    }
+    for (OdomSource* source : {&vertical1Source, &vertical2Source, &driveLeftSource, &driveRightSource}) {
+        if (verticalSource == nullptr && source->usable) verticalSource = source;
+    }
+    if (horizontal1Source.usable) horizontalSource = &horizontal1Source;
+    else if (horizontal2Source.usable) horizontalSource = &horizontal2Source;
+    lemlib::TrackingWheel* verticalWheel = verticalSource != nullptr ? verticalSource->wheel : nullptr;
+    lemlib::TrackingWheel* horizontalWheel = horizontalSource != nullptr ? horizontalSource->wheel : nullptr;
     float horizontalOffset = 0;
     float verticalOffset = 0;
     if (verticalWheel != nullptr) verticalOffset = verticalWheel->getOffset();
@@ -145,49 +786,64 @@ void lemlib::update() {
     // calculate change in x and y
     float deltaX = 0;
     float deltaY = 0;
-    if (verticalWheel != nullptr) deltaY = rawVertical - prevVertical;
-    if (horizontalWheel != nullptr) deltaX = rawHorizontal - prevHorizontal;
-    prevVertical = rawVertical;
-    prevHorizontal = rawHorizontal;
+    if (verticalSource != nullptr) deltaY = verticalSource->delta;
+    if (horizontalSource != nullptr) deltaX = horizontalSource->delta;
 
-    // calculate local x and y
-    float localX = 0;
-    float localY = 0;
-    if (deltaHeading == 0) { // prevent divide by 0
-        localX = deltaX;
-        localY = deltaY;
+    if (odomSettings.integration == lemlib::OdomIntegration::EXACT) {
+        integrateExact(deltaX, deltaY, deltaHeading, horizontalOffset, verticalOffset);
     } else {
-        localX = 2 * sin(deltaHeading / 2) * (deltaX / deltaHeading + horizontalOffset);
-        localY = 2 * sin(deltaHeading / 2) * (deltaY / deltaHeading + verticalOffset);
+        integrateArc(deltaX, deltaY, deltaHeading, horizontalOffset, verticalOffset);
     }
 
-    // save previous pose
-    lemlib::Pose prevPose = odomPose;
-
-    // calculate global x and y
-    odomPose.x += localY * sin(avgHeading);
-    odomPose.y += localY * cos(avgHeading);
-    odomPose.x += localX * -cos(avgHeading);
-    odomPose.y += localX * sin(avgHeading);
-    odomPose.theta = heading;
+    // calculate local speed
+    // the tracking wheels measure velocity directly, so there's no need to differentiate position.
+    // Rotation about the tracking center also moves the wheels, which has to be removed
+    const float angularSpeed = ema(deltaHeading / dt, odomLocalSpeed.theta, 0.95);
+    float localSpeedX = 0;
+    float localSpeedY = 0;
+    if (verticalWheel != nullptr) localSpeedY = verticalWheel->getVelocity() + verticalOffset * angularSpeed;
+    if (horizontalWheel != nullptr) localSpeedX = horizontalWheel->getVelocity() + horizontalOffset * angularSpeed;
+    odomLocalSpeed.x = localSpeedX;
+    odomLocalSpeed.y = localSpeedY;
+    odomLocalSpeed.theta = angularSpeed;
 
     // calculate speed
-    odomSpeed.x = ema((odomPose.x - prevPose.x) / 0.01, odomSpeed.x, 0.95);
-    odomSpeed.y = ema((odomPose.y - prevPose.y) / 0.01, odomSpeed.y, 0.95);
-    odomSpeed.theta = ema((odomPose.theta - prevPose.theta) / 0.01, odomSpeed.theta, 0.95);
+    odomSpeed.x = localSpeedY * sin(heading) - localSpeedX * cos(heading);
+    odomSpeed.y = localSpeedY * cos(heading) + localSpeedX * sin(heading);
+    odomSpeed.theta = angularSpeed;
 
-    // calculate local speed
-    odomLocalSpeed.x = ema(localX / 0.01, odomLocalSpeed.x, 0.95);
-    odomLocalSpeed.y = ema(localY / 0.01, odomLocalSpeed.y, 0.95);
-    odomLocalSpeed.theta = ema(deltaHeading / 0.01, odomLocalSpeed.theta, 0.95);
+    // estimate wheel slip
+    const bool groundReference = verticalWheel != nullptr && !verticalWheel->getType() && !headingFromDrive;
+    updateSlip(localSpeedY, angularSpeed, groundReference, dt);
+
+    // remember the pose for latency compensation, and correct it with the GPS
+    poseHistory[poseHistoryIndex] = {pros::millis(), odomPose};
+    poseHistoryIndex = (poseHistoryIndex + 1) % POSE_HISTORY_SIZE;
+    poseHistoryCount = std::min(poseHistoryCount + 1, POSE_HISTORY_SIZE);
+    fuseGps();
 }
 
 void lemlib::init() {
+    // start measuring from the current sensor values
+    for (OdomSource* source : {&vertical1Source, &vertical2Source, &horizontal1Source, &horizontal2Source,
+                               &driveLeftSource, &driveRightSource}) {
+        readSource(*source);
+    }
+    for (OdomSource& source : imuSources) readSource(source);
+    // get new sensor data as often as odometry updates
+    if (odomSensors.vertical1 != nullptr) odomSensors.vertical1->setDataRate(odomSettings.rate);
+    if (odomSensors.vertical2 != nullptr) odomSensors.vertical2->setDataRate(odomSettings.rate);
+    if (odomSensors.horizontal1 != nullptr) odomSensors.horizontal1->setDataRate(odomSettings.rate);
+    if (odomSensors.horizontal2 != nullptr) odomSensors.horizontal2->setDataRate(odomSettings.rate);
+    for (pros::Imu* imu : odomSensors.imus) imu->set_data_rate(odomSettings.rate);
+    if (odomSensors.gps != nullptr) odomSensors.gps->set_data_rate(odomSettings.gpsRate);
     if (trackingTask == nullptr) {
         trackingTask = new pros::Task {[=] {
+            std::uint32_t time = pros::millis();
             while (true) {
                 update();
-                pros::delay(10);
+                // delay_until keeps the period fixed regardless of how long the update took
+                pros::Task::delay_until(&time, odomSettings.rate);
             }
         }};
     }
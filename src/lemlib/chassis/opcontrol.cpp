@@ -4,24 +4,24 @@
 
 namespace lemlib {
 
-ExpoDriveCurve defaultDriveCurve = ExpoDriveCurve(0, 0, 1);
+// constinit, so the table is filled at compile time and the curve is ready before any chassis is constructed
+constinit ExpoDriveCurve defaultDriveCurve(0, 0, 1);
 
 void Chassis::tank(int left, int right, bool disableDriveCurve) {
     if (disableDriveCurve) {
-        drivetrain.leftMotors->move(left);
-        drivetrain.rightMotors->move(right);
+        setDrivePower(left, right);
     } else {
-        drivetrain.leftMotors->move(throttleCurve->curve(left));
-        drivetrain.rightMotors->move(throttleCurve->curve(right));
+        setDrivePower(throttleCurve->lookup(left), throttleCurve->lookup(right));
     }
 }
 
 void Chassis::arcade(int throttle, int turn, bool disableDriveCurve, float desaturateBias) {
     // use drive curves if they have not been disabled
     if (!disableDriveCurve) {
-        throttle = std::round(throttleCurve->curve(throttle));
-        turn = std::round(steerCurve->curve(turn));
+        throttle = std::round(throttleCurve->lookup(throttle));
+        turn = std::round(steerCurve->lookup(turn));
     }
+    turn = std::round(holdHeading(throttle, turn, turn));
     // desaturate motors based on joyBias
     if (std::abs(throttle) + std::abs(turn) > 127) {
         int oldThrottle = throttle;
@@ -36,12 +36,57 @@ void Chassis::arcade(int throttle, int turn, bool disableDriveCurve, float desat
         }
     }
 
-    int leftPower = throttle + turn;
-    int rightPower = throttle - turn;
-
     // move drive
-    drivetrain.leftMotors->move(leftPower);
-    drivetrain.rightMotors->move(rightPower);
+    setDriveOutput(throttle, turn);
+}
+
+void Chassis::setHeadingHold(bool enabled, HeadingHoldSettings settings) {
+    headingHold = enabled;
+    headingHoldSettings = settings;
+    headingHoldPID.setGains(settings.kP, settings.kI, settings.kD);
+    // the locked heading doesn't change, so the derivative is taken on the heading
+    headingHoldPID.setDerivativeOnMeasurement(true);
+    headingHoldPID.setOutputLimit(settings.maxCorrection);
+    heldHeading = NAN;
+    holdCorrection = 0;
+}
+
+float Chassis::holdHeading(float throttle, float turn, float angular) {
+    if (!headingHold) return angular;
+    const std::uint32_t now = pros::millis();
+    // start over if driver control was paused
+    if (now - lastHoldTime > 100) {
+        heldHeading = NAN;
+        holdCorrection = 0;
+        stillSince = 0;
+    }
+    lastHoldTime = now;
+
+    // release the hold while the driver is turning, or not driving
+    if (std::fabs(turn) > headingHoldSettings.deadband || throttle == 0) {
+        if (!std::isnan(heldHeading)) {
+            heldHeading = NAN;
+            releaseStart = now;
+        }
+        stillSince = 0;
+    } else if (stillSince == 0) {
+        stillSince = now;
+    }
+
+    // lock the heading once the robot has had time to stop turning
+    const float heading = getPose().theta;
+    if (std::isnan(heldHeading) && stillSince != 0 && now - stillSince >= headingHoldSettings.lockDelay) {
+        heldHeading = heading;
+        headingHoldPID.reset();
+    }
+    if (std::isnan(heldHeading)) {
+        // fade the last correction out, so the robot doesn't jerk when the hold is released
+        const float fade =
+            headingHoldSettings.releaseTime > 0 ? 1 - float(now - releaseStart) / headingHoldSettings.releaseTime : 0;
+        return angular + holdCorrection * std::max(fade, 0.0f);
+    }
+    holdCorrection = headingHoldPID.update(heldHeading - heading, 0, heading);
+    return holdCorrection;
 }
 
 void Chassis::curvature(int throttle, int turn, bool disableDriveCurve) {
@@ -53,20 +98,11 @@ void Chassis::curvature(int throttle, int turn, bool disableDriveCurve) {
 
     // use drive curves if they have not been disabled
     if (!disableDriveCurve) {
-        throttle = throttleCurve->curve(throttle);
-        turn = steerCurve->curve(turn);
+        throttle = throttleCurve->lookup(throttle);
+        turn = steerCurve->lookup(turn);
     }
 
-    float leftPower = throttle + (std::fabs(throttle) * turn / 127.0);
-    float rightPower = throttle - (std::fabs(throttle) * turn / 127.0);
-
-    // desaturate output
-    float max = std::max(std::fabs(leftPower), std::fabs(rightPower)) / 127;
-    if (max > 1) {
-        leftPower /= max;
-        rightPower /= max;
-    }
-    drivetrain.leftMotors->move(leftPower);
-    drivetrain.rightMotors->move(rightPower);
+    // the turn is scaled by the throttle, so the robot follows the same curve at any speed
+    setDriveOutput(throttle, holdHeading(throttle, turn, std::fabs(throttle) * turn / 127.0));
 }
 } // namespace lemlib
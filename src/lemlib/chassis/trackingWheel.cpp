@@ -1,8 +1,14 @@
+#include <cmath>
 #include "lemlib/chassis/trackingWheel.hpp"
 #include "lemlib/util.hpp"
 #include "pros/abstract_motor.hpp"
 #include "pros/motor_group.hpp"
 #include "pros/motors.h"
+#include "pros/rtos.hpp"
+#include "pros/error.h"
+
+// shortest time optical shaft encoder velocity is measured over, in microseconds
+constexpr std::uint32_t VELOCITY_WINDOW = 10000;
 
 lemlib::TrackingWheel::TrackingWheel(pros::adi::Encoder* encoder, float wheelDiameter, float distance,
                                      float gearRatio) {
@@ -35,9 +41,13 @@ void lemlib::TrackingWheel::reset() {
 
 float lemlib::TrackingWheel::getDistanceTraveled() {
     if (this->encoder != nullptr) {
-        return (float(this->encoder->get_value()) * this->diameter * M_PI / 360) / this->gearRatio;
+        const std::int32_t value = this->encoder->get_value();
+        if (value == PROS_ERR) return NAN;
+        return (float(value) * this->diameter * M_PI / 360) / this->gearRatio;
     } else if (this->rotation != nullptr) {
-        return (float(this->rotation->get_position()) * this->diameter * M_PI / 36000) / this->gearRatio;
+        const std::int32_t position = this->rotation->get_position();
+        if (position == PROS_ERR) return NAN;
+        return (float(position) * this->diameter * M_PI / 36000) / this->gearRatio;
     } else if (this->motors != nullptr) {
         // get distance traveled by each motor
         std::vector<pros::MotorGears> gearsets = this->motors->get_gearing_all();
@@ -51,14 +61,64 @@ float lemlib::TrackingWheel::getDistanceTraveled() {
                 case pros::MotorGears::blue: in = 600; break;
                 default: in = 200; break;
             }
+            // skip motors that are disconnected
+            if (!std::isfinite(positions[i])) continue;
             distances.push_back(positions[i] * (diameter * M_PI) * (rpm / in));
         }
+        if (distances.empty()) return NAN;
         return lemlib::avg(distances);
     } else {
         return 0;
     }
 }
 
+float lemlib::TrackingWheel::getVelocity() {
+    if (this->encoder != nullptr) {
+        // optical shaft encoders don't measure velocity, so differentiate the distance traveled
+        // the distance is differentiated over a fixed window, so every caller gets the same velocity no matter how
+        // often the wheel is read
+        const std::uint32_t now = pros::micros();
+        if (this->prevTime != 0 && now - this->prevTime < VELOCITY_WINDOW) return this->velocity;
+        const float distance = this->getDistanceTraveled();
+        if (std::isnan(distance)) return NAN;
+        const float dt = (now - this->prevTime) / 1000000.0;
+        this->velocity = this->prevTime == 0 ? 0 : (distance - this->prevDistance) / dt;
+        this->prevDistance = distance;
+        this->prevTime = now;
+        return this->velocity;
+    } else if (this->rotation != nullptr) {
+        const std::int32_t velocity = this->rotation->get_velocity();
+        if (velocity == PROS_ERR) return NAN;
+        return (float(velocity) * this->diameter * M_PI / 36000) / this->gearRatio;
+    } else if (this->motors != nullptr) {
+        // get the velocity of each motor
+        std::vector<pros::MotorGears> gearsets = this->motors->get_gearing_all();
+        std::vector<double> velocities = this->motors->get_actual_velocity_all();
+        std::vector<float> speeds;
+        for (int i = 0; i < this->motors->size(); i++) {
+            float in;
+            switch (gearsets[i]) {
+                case pros::MotorGears::red: in = 100; break;
+                case pros::MotorGears::green: in = 200; break;
+                case pros::MotorGears::blue: in = 600; break;
+                default: in = 200; break;
+            }
+            // skip motors that are disconnected
+            if (!std::isfinite(velocities[i])) continue;
+            // convert from rpm to inches per second
+            speeds.push_back(velocities[i] * (diameter * M_PI) * (rpm / in) / 60);
+        }
+        if (speeds.empty()) return NAN;
+        return lemlib::avg(speeds);
+    } else {
+        return 0;
+    }
+}
+
+void lemlib::TrackingWheel::setDataRate(std::uint32_t rate) {
+    if (this->rotation != nullptr) this->rotation->set_data_rate(rate);
+}
+
 float lemlib::TrackingWheel::getOffset() { return this->distance; }
 
 int lemlib::TrackingWheel::getType() {
@@ -2,12 +2,9 @@
 #include <cmath>
 
 namespace lemlib {
-ExpoDriveCurve::ExpoDriveCurve(float deadband, float minOutput, float curve)
-    : deadband(deadband),
-      minOutput(minOutput),
-      curveGain(curve) {}
-
 float ExpoDriveCurve::curve(float input) {
+    // whole inputs are in the table
+    if (input == int(input) && fabs(input) <= 127) return table[int(input) + 127];
     // return 0 if input is within deadzone
     if (fabs(input) <= deadband) return 0;
     // g is the output of g(x) as defined in the Desmos graph
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <algorithm>
 #include "pros/rtos.hpp"
 #include "lemlib/exitcondition.hpp"
 
@@ -9,16 +10,63 @@ ExitCondition::ExitCondition(const float range, const int time)
 
 bool ExitCondition::getExit() { return done; }
 
-bool ExitCondition::update(const float input) {
+bool ExitCondition::update(const float input, const float velocity) {
     const int curTime = pros::millis();
     if (std::fabs(input) > range) startTime = -1;
     else if (startTime == -1) startTime = curTime;
     else if (curTime >= startTime + time) done = true;
+    if (maxRate > 0 && updateSettle(input, velocity, curTime)) done = true;
     return done;
 }
 
+void ExitCondition::setSettle(float maxRate, float maxVelocity, int settleTime, int window, float maxDeviation) {
+    this->maxRate = maxRate;
+    this->maxVelocity = maxVelocity;
+    this->settleTime = settleTime;
+    this->window = std::clamp(window, 0, MAX_WINDOW);
+    this->maxDeviation = maxDeviation;
+}
+
+bool ExitCondition::updateSettle(float input, float velocity, int curTime) {
+    // rate of change of the input
+    const std::uint32_t now = pros::micros();
+    float rate = NAN;
+    if (prevInputTime != 0 && now > prevInputTime) rate = (input - prevInput) / ((now - prevInputTime) / 1000000.0);
+    prevInput = input;
+    prevInputTime = now;
+
+    // standard deviation of the recent inputs
+    bool steady = true;
+    if (window > 0) {
+        history[historyIndex] = input;
+        historyIndex = (historyIndex + 1) % window;
+        historyCount = std::min(historyCount + 1, window);
+        if (historyCount < window) {
+            steady = false;
+        } else {
+            float mean = 0;
+            for (int i = 0; i < window; i++) mean += history[i];
+            mean /= window;
+            float variance = 0;
+            for (int i = 0; i < window; i++) variance += (history[i] - mean) * (history[i] - mean);
+            steady = variance / window <= maxDeviation * maxDeviation;
+        }
+    }
+
+    const bool slow = maxVelocity <= 0 || !std::isfinite(velocity) || std::fabs(velocity) <= maxVelocity;
+    const bool settled =
+        std::fabs(input) <= range && std::isfinite(rate) && std::fabs(rate) <= maxRate && slow && steady;
+    if (!settled) settleStartTime = -1;
+    else if (settleStartTime == -1) settleStartTime = curTime;
+    return settleStartTime != -1 && curTime >= settleStartTime + settleTime;
+}
+
 void ExitCondition::reset() {
     startTime = -1;
     done = false;
+    settleStartTime = -1;
+    prevInputTime = 0;
+    historyIndex = 0;
+    historyCount = 0;
 }
 } // namespace lemlib
\ No newline at end of file
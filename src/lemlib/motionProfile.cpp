@@ -0,0 +1,213 @@
+#include <cmath>
+#include <algorithm>
+#include "lemlib/motionProfile.hpp"
+
+namespace lemlib {
+// how many segments the distance is split into when planning
+constexpr int PROFILE_SEGMENTS = 200;
+// time step of jerk limited profiles, in seconds. The jerk is constant within a step
+constexpr float JERK_TIME_STEP = 0.01;
+// most steps in a jerk limited profile, which is 5 minutes
+constexpr int MAX_JERK_STEPS = 30000;
+
+/**
+ * @brief Calculate the fastest velocities starting from a velocity, accelerating forwards along the segments
+ *
+ * Running this from the end of the profile backwards gives the fastest velocities that can still decelerate in time
+ *
+ * @param velocities velocity at the start of every segment. The first one is the starting velocity
+ * @param limits maximum velocity at the start of every segment
+ * @param ds length of a segment
+ */
+void accelerate(std::vector<float>& velocities, const std::vector<float>& limits, float ds, float maxAcceleration) {
+    for (std::size_t i = 0; i + 1 < velocities.size(); i++) {
+        const float velocity = velocities[i];
+        velocities[i + 1] = std::min(limits[i + 1], std::sqrt(velocity * velocity + 2 * maxAcceleration * ds));
+    }
+}
+
+/**
+ * @brief Get the state some time after another one, holding its jerk
+ */
+ProfileState advance(const ProfileState& state, float dt) {
+    return {state.time + dt,
+            state.position + state.velocity * dt + state.acceleration * dt * dt / 2 + state.jerk * dt * dt * dt / 6,
+            state.velocity + state.acceleration * dt + state.jerk * dt * dt / 2, state.acceleration + state.jerk * dt,
+            state.jerk};
+}
+
+/**
+ * @brief Get the jerk for the next step of stopping as fast as possible from a forwards velocity
+ *
+ * The deceleration ramps up to the maximum, holds, and ramps back down so the velocity and acceleration reach 0
+ * together
+ */
+float stoppingJerk(const ProfileState& state, float maxAcceleration, float maxJerk) {
+    const float acceleration = state.acceleration;
+    const float jerk = std::max(-maxJerk, (-maxAcceleration - acceleration) / JERK_TIME_STEP);
+    // ramping the deceleration down to 0 at a constant jerk takes away a^2 / 2j of velocity. Start the ramp if it
+    // would be too late after this step, with the jerk that reaches 0 velocity and acceleration together
+    const ProfileState next = advance({0, 0, state.velocity, acceleration, jerk}, JERK_TIME_STEP);
+    if (acceleration < 0 && next.velocity <= next.acceleration * next.acceleration / (2 * maxJerk)) {
+        return std::min(maxJerk, acceleration * acceleration / (2 * std::max(state.velocity, 1e-6f)));
+    }
+    return jerk;
+}
+
+MotionProfile::MotionProfile(float distance, float maxVelocity, float maxAcceleration, float maxJerk,
+                             float startVelocity, float endVelocity)
+    : MotionProfile(distance, std::vector<float> {maxVelocity}, maxAcceleration, maxJerk, startVelocity,
+                    endVelocity) {}
+
+MotionProfile::MotionProfile(float distance, const std::vector<float>& maxVelocities, float maxAcceleration,
+                             float maxJerk, float startVelocity, float endVelocity) {
+    if (distance <= 0 || maxVelocities.empty() || maxAcceleration <= 0 ||
+        *std::max_element(maxVelocities.begin(), maxVelocities.end()) <= 0) {
+        states.push_back({0, 0, 0, 0});
+        return;
+    }
+
+    // the acceleration can't ramp over less than a few steps, and a ramp that short wouldn't be smoother anyway
+    if (maxJerk > 0) maxJerk = std::min(maxJerk, maxAcceleration / (4 * JERK_TIME_STEP));
+
+    // a robot moving backwards has to stop first, so the rest of the profile starts behind where it was planned from
+    ProfileState start {0, 0, startVelocity, 0};
+    if (startVelocity < 0 && maxJerk <= 0) {
+        states.push_back({0, 0, startVelocity, maxAcceleration});
+        start = {-startVelocity / maxAcceleration, -startVelocity * startVelocity / (2 * maxAcceleration), 0, 0};
+    } else if (startVelocity < 0) {
+        // stopping backwards is stopping forwards mirrored
+        while (start.velocity < 0 && states.size() < MAX_JERK_STEPS) {
+            const ProfileState mirrored = {start.time, -start.position, -start.velocity, -start.acceleration};
+            start.jerk = -stoppingJerk(mirrored, maxAcceleration, maxJerk);
+            states.push_back(start);
+            start = advance(start, JERK_TIME_STEP);
+        }
+        start.jerk = 0;
+    }
+    const float ds = (distance - start.position) / PROFILE_SEGMENTS;
+
+    // maximum velocity at the start of every segment, interpolated from the limits spaced evenly from 0 to the
+    // distance
+    std::vector<float> limits(PROFILE_SEGMENTS + 1);
+    for (int i = 0; i <= PROFILE_SEGMENTS; i++) {
+        const float fraction = std::clamp((start.position + i * ds) / distance, 0.0f, 1.0f);
+        const float index = fraction * (maxVelocities.size() - 1);
+        const std::size_t lower = std::min(std::size_t(index), maxVelocities.size() - 1);
+        const std::size_t upper = std::min(lower + 1, maxVelocities.size() - 1);
+        const float t = index - lower;
+        limits[i] = std::max(maxVelocities[lower] * (1 - t) + maxVelocities[upper] * t, 0.0f);
+    }
+    endVelocity = std::clamp(endVelocity, 0.0f, limits.back());
+
+    // the fastest velocities that can still decelerate in time
+    std::vector<float> backwards(PROFILE_SEGMENTS + 1, endVelocity);
+    std::reverse(limits.begin(), limits.end());
+    accelerate(backwards, limits, ds, maxAcceleration);
+    std::reverse(limits.begin(), limits.end());
+    std::reverse(backwards.begin(), backwards.end());
+
+    if (maxJerk <= 0) {
+        // accelerate from the start and take the slower of the two
+        std::vector<float> forwards(PROFILE_SEGMENTS + 1, std::min(start.velocity, limits.front()));
+        accelerate(forwards, limits, ds, maxAcceleration);
+
+        // find when the robot reaches each segment. The acceleration is constant within a segment
+        states.reserve(states.size() + PROFILE_SEGMENTS + 1);
+        float time = start.time;
+        for (int i = 0; i <= PROFILE_SEGMENTS; i++) {
+            const float velocity = std::min(forwards[i], backwards[i]);
+            if (i > 0) {
+                ProfileState& prev = states.back();
+                const float sum = prev.velocity + velocity;
+                const float dt = sum > 1e-6 ? 2 * ds / sum : std::sqrt(2 * ds / maxAcceleration);
+                prev.acceleration = (velocity - prev.velocity) / dt;
+                time += dt;
+            }
+            states.push_back({time, start.position + i * ds, velocity, 0});
+        }
+        return;
+    }
+
+    // the fastest velocity that can still decelerate in time at a position. The squared velocity is interpolated,
+    // since it changes linearly with position at a constant acceleration. Past the end the robot keeps the end
+    // velocity
+    auto limit = [&](float position) {
+        if (position >= distance) return endVelocity;
+        const float index = std::max((position - start.position) / ds, 0.0f);
+        const int i = std::min(int(index), PROFILE_SEGMENTS - 1);
+        const float t = std::min(index - i, 1.0f);
+        return std::sqrt(backwards[i] * backwards[i] * (1 - t) + backwards[i + 1] * backwards[i + 1] * t);
+    };
+    // whether the robot can stop from a state without going over the limit
+    auto canStop = [&](ProfileState state) {
+        for (int i = 0; i < MAX_JERK_STEPS; i++) {
+            if (state.velocity > limit(state.position) + 1e-3) return false;
+            if (state.velocity <= 0) return true;
+            state.jerk = stoppingJerk(state, maxAcceleration, maxJerk);
+            // the limit never falls faster than the maximum deceleration, so it can't be crossed while holding it.
+            // Skip to where the deceleration ramps back down
+            const float rampVelocity = maxAcceleration * maxAcceleration / (2 * maxJerk);
+            if (state.jerk == 0 && state.acceleration <= -maxAcceleration + 1e-3 &&
+                state.velocity > rampVelocity + maxAcceleration * JERK_TIME_STEP) {
+                state = advance(state, (state.velocity - rampVelocity) / maxAcceleration - JERK_TIME_STEP);
+                continue;
+            }
+            state = advance(state, JERK_TIME_STEP);
+        }
+        return true;
+    };
+
+    // every step, take the most jerk that the robot can still stop from. Stopping is always possible from the state
+    // before, so this never goes over the limit unless the robot starts too fast to stop in time. Then it stops as
+    // fast as it can
+    ProfileState state = start;
+    while (state.position < distance && states.size() < MAX_JERK_STEPS) {
+        const float lowest = stoppingJerk(state, maxAcceleration, maxJerk);
+        float highest = std::min(maxJerk, (maxAcceleration - state.acceleration) / JERK_TIME_STEP);
+        state.jerk = highest;
+        if (!canStop(advance(state, JERK_TIME_STEP))) {
+            float low = lowest;
+            for (int i = 0; i < 5; i++) {
+                state.jerk = (low + highest) / 2;
+                if (canStop(advance(state, JERK_TIME_STEP))) low = state.jerk;
+                else highest = state.jerk;
+            }
+            state.jerk = low;
+        }
+        const ProfileState next = advance(state, JERK_TIME_STEP);
+        // the robot stopped just short of the end
+        if (next.velocity <= 0 && state.velocity <= 0 && next.acceleration <= 0) break;
+        states.push_back(state);
+        state = next;
+    }
+
+    // end exactly at the distance, partway through the last step
+    if (state.position > distance) {
+        const ProfileState& last = states.back();
+        float low = 0;
+        float high = JERK_TIME_STEP;
+        for (int i = 0; i < 20; i++) {
+            const float dt = (low + high) / 2;
+            if (advance(last, dt).position < distance) low = dt;
+            else high = dt;
+        }
+        state = advance(last, high);
+    }
+    state.position = distance;
+    state.velocity = std::max(state.velocity, 0.0f);
+    state.jerk = 0;
+    states.push_back(state);
+}
+
+ProfileState MotionProfile::sample(float time) const {
+    if (time <= 0) return states.front();
+    if (time >= states.back().time) return states.back();
+    // find the segment the time is in
+    const auto next = std::upper_bound(states.begin(), states.end(), time,
+                                       [](float time, const ProfileState& state) { return time < state.time; });
+    return advance(*(next - 1), time - (next - 1)->time);
+}
+
+float MotionProfile::getDuration() const { return states.back().time; }
+} // namespace lemlib
@@ -0,0 +1,139 @@
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include "lemlib/mpc.hpp"
+#include "lemlib/util.hpp"
+
+namespace lemlib {
+// number of errors in the model: along track, cross track and heading
+constexpr int STATES = 3;
+// number of inputs in the model: left and right wheel velocities
+constexpr int INPUTS = 2;
+
+MPC::MPC(float trackWidth, MPCSettings settings)
+    : trackWidth(trackWidth),
+      settings(settings) {
+    this->settings.horizon = std::clamp(settings.horizon, 1, MAX_HORIZON);
+    const int n = this->settings.horizon;
+    prediction.resize(STATES * n * INPUTS * n);
+    freeResponse.resize(STATES * n);
+    hessian.resize(INPUTS * n * INPUTS * n);
+    gradient.resize(INPUTS * n);
+    lower.resize(INPUTS * n);
+    upper.resize(INPUTS * n);
+    solution.resize(INPUTS * n);
+}
+
+void MPC::reset() { std::fill(solution.begin(), solution.end(), 0); }
+
+MPCOutput MPC::update(const Pose& pose, const Pose& reference, const std::vector<MPCReference>& trajectory,
+                      float maxVelocity) {
+    const int n = settings.horizon;
+    const int columns = INPUTS * n;
+    const float dt = settings.timeStep;
+    const std::array<float, STATES> weights = {settings.alongWeight, settings.crossWeight, settings.headingWeight};
+    auto step = [&](int k) {
+        if (trajectory.empty()) return MPCReference {0, 0};
+        return trajectory[std::min<std::size_t>(k, trajectory.size() - 1)];
+    };
+
+    // error in the frame of the reference. Headings are converted to standard position, so turning left is positive
+    const float referenceHeading = M_PI_2 - reference.theta;
+    const float dx = pose.x - reference.x;
+    const float dy = pose.y - reference.y;
+    std::array<float, STATES> error = {float(dx * cos(referenceHeading) + dy * sin(referenceHeading)),
+                                       float(-dx * sin(referenceHeading) + dy * cos(referenceHeading)),
+                                       angleError(M_PI_2 - pose.theta, referenceHeading, true)};
+
+    // the linearized error model over one step:
+    // along(k + 1) = along + dt * (angular * cross + velocity change)
+    // cross(k + 1) = cross + dt * (-angular * along + velocity * heading)
+    // heading(k + 1) = heading + dt * angular velocity change
+    // where the velocity changes come from the wheel velocities. B is the same for every step
+    const std::array<float, STATES * INPUTS> b = {dt / 2, dt / 2, 0, 0, -dt / trackWidth, dt / trackWidth};
+    auto applyA = [&](int k, const float* in, float* out) {
+        const MPCReference ref = step(k);
+        const float angular = -ref.velocity * ref.curvature;
+        out[0] = in[0] + dt * angular * in[1];
+        out[1] = in[1] + dt * (-angular * in[0] + ref.velocity * in[2]);
+        out[2] = in[2];
+    };
+
+    // free response: how the error evolves with the reference wheel velocities
+    std::array<float, STATES> current = error;
+    for (int k = 0; k < n; k++) {
+        applyA(k, current.data(), &freeResponse[STATES * k]);
+        std::copy_n(&freeResponse[STATES * k], STATES, current.begin());
+    }
+
+    // condensed prediction matrix. Row block i, column block j is A(i)...A(j + 1) * B for i >= j
+    std::fill(prediction.begin(), prediction.end(), 0);
+    for (int j = 0; j < n; j++) {
+        for (int input = 0; input < INPUTS; input++) {
+            std::array<float, STATES> column = {b[input], b[INPUTS + input], b[2 * INPUTS + input]};
+            for (int i = j; i < n; i++) {
+                if (i > j) {
+                    std::array<float, STATES> next;
+                    applyA(i, column.data(), next.data());
+                    column = next;
+                }
+                for (int s = 0; s < STATES; s++) {
+                    prediction[(STATES * i + s) * columns + INPUTS * j + input] = column[s];
+                }
+            }
+        }
+    }
+
+    // hessian = P' Q P + R, gradient = P' Q f. Only the lower triangle is calculated since it's symmetric, and the
+    // predictions are zero above the diagonal blocks
+    for (int c1 = 0; c1 < columns; c1++) {
+        float g = 0;
+        for (int row = STATES * (c1 / INPUTS); row < STATES * n; row++) {
+            g += prediction[row * columns + c1] * weights[row % STATES] * freeResponse[row];
+        }
+        gradient[c1] = g;
+        for (int c2 = 0; c2 <= c1; c2++) {
+            float h = 0;
+            for (int row = STATES * (c1 / INPUTS); row < STATES * n; row++) {
+                h += prediction[row * columns + c1] * weights[row % STATES] * prediction[row * columns + c2];
+            }
+            hessian[c1 * columns + c2] = h;
+            hessian[c2 * columns + c1] = h;
+        }
+        hessian[c1 * columns + c1] += settings.velocityWeight;
+    }
+
+    // the wheel velocities have to stay within the maximum
+    for (int k = 0; k < n; k++) {
+        const MPCReference ref = step(k);
+        const float left = ref.velocity * (1 + ref.curvature * trackWidth / 2);
+        const float right = ref.velocity * (1 - ref.curvature * trackWidth / 2);
+        lower[INPUTS * k] = -maxVelocity - left;
+        upper[INPUTS * k] = maxVelocity - left;
+        lower[INPUTS * k + 1] = -maxVelocity - right;
+        upper[INPUTS * k + 1] = maxVelocity - right;
+    }
+
+    // warm start from the last solution, shifted by a step
+    std::rotate(solution.begin(), solution.begin() + INPUTS, solution.end());
+    std::fill(solution.end() - INPUTS, solution.end(), 0);
+
+    // projected Gauss-Seidel. Each sweep minimizes the cost along every input in turn, within its bounds
+    for (int iteration = 0; iteration < settings.iterations; iteration++) {
+        float change = 0;
+        for (int c = 0; c < columns; c++) {
+            float residual = gradient[c];
+            for (int other = 0; other < columns; other++) residual += hessian[c * columns + other] * solution[other];
+            const float value = std::clamp(solution[c] - residual / hessian[c * columns + c], lower[c], upper[c]);
+            change = std::max(change, std::fabs(value - solution[c]));
+            solution[c] = value;
+        }
+        if (change < settings.tolerance) break;
+    }
+
+    // only the first step is used, the rest is planned again on the next update
+    const MPCReference ref = step(0);
+    return {ref.velocity * (1 + ref.curvature * trackWidth / 2) + solution[0],
+            ref.velocity * (1 - ref.curvature * trackWidth / 2) + solution[1]};
+}
+} // namespace lemlib
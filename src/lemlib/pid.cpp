@@ -1,7 +1,43 @@
+#include <algorithm>
+#include "pros/rtos.hpp"
 #include "pid.hpp"
 #include "util.hpp"
 
 namespace lemlib {
+// the gains are scaled as if the PID was updated this often, in seconds
+constexpr float NOMINAL_DT = 0.01;
+
+GainSchedule::GainSchedule(std::vector<GainPoint> points) {
+    if (points.empty()) return;
+    std::sort(points.begin(), points.end(), [](const GainPoint& a, const GainPoint& b) { return a.error < b.error; });
+    enabled = true;
+    step = points.back().error / SIZE;
+    // sample the piecewise linear schedule at evenly spaced errors
+    std::size_t segment = 0;
+    for (int i = 0; i <= SIZE; i++) {
+        const float error = i * step;
+        while (segment + 1 < points.size() && points[segment + 1].error < error) segment++;
+        const GainPoint& a = points[segment];
+        const GainPoint& b = points[std::min(segment + 1, points.size() - 1)];
+        const float t = b.error > a.error ? std::clamp((error - a.error) / (b.error - a.error), 0.0f, 1.0f) : 0;
+        table[i] = {error, a.kP + (b.kP - a.kP) * t, a.kI + (b.kI - a.kI) * t, a.kD + (b.kD - a.kD) * t};
+    }
+}
+
+GainPoint GainSchedule::lookup(float error) const {
+    error = fabs(error);
+    if (step <= 0) return table[0];
+    // index the table directly, then interpolate between the 2 nearest entries
+    const float index = std::min(error / step, float(SIZE));
+    const int i = std::min(int(index), SIZE - 1);
+    const float t = index - i;
+    const GainPoint& a = table[i];
+    const GainPoint& b = table[i + 1];
+    return {error, a.kP + (b.kP - a.kP) * t, a.kI + (b.kI - a.kI) * t, a.kD + (b.kD - a.kD) * t};
+}
+
+bool GainSchedule::isEnabled() const { return enabled; }
+
 PID::PID(float kP, float kI, float kD, float windupRange, bool signFlipReset)
     : kP(kP),
       kI(kI),
@@ -9,22 +45,65 @@ PID::PID(float kP, float kI, float kD, float windupRange, bool signFlipReset)
       windupRange(windupRange),
       signFlipReset(signFlipReset) {}
 
-float PID::update(const float error) {
+float PID::update(const float error, float dt, const float measurement, const float feedforward) {
+    // measure the time since the last update
+    // fall back to the nominal time step on the first update, or if the timer misbehaves
+    const std::uint32_t now = pros::micros();
+    if (dt <= 0) {
+        dt = (now - prevTime) / 1000000.0;
+        if (prevTime == 0 || dt <= 0 || dt > 0.1) dt = NOMINAL_DT;
+    }
+    prevTime = now;
+    const float steps = dt / NOMINAL_DT;
+
     // calculate integral
-    integral += error;
+    const float prevIntegral = integral;
+    integral += error * steps;
     if (sgn(error) != sgn((prevError)) && signFlipReset) integral = 0;
     if (fabs(error) > windupRange && windupRange != 0) integral = 0;
 
     // calculate derivative
-    const float derivative = error - prevError;
+    float rawDerivative = (error - prevError) / steps;
+    if (derivativeOnMeasurement && std::isfinite(measurement)) {
+        // the derivative of the error is minus the derivative of the measurement if the target doesn't change
+        rawDerivative = std::isfinite(prevMeasurement) ? -(measurement - prevMeasurement) / steps : 0;
+    }
+    if (derivativeFilter > 0) derivative += dt / (derivativeFilter + dt) * (rawDerivative - derivative);
+    else derivative = rawDerivative;
     prevError = error;
+    prevMeasurement = measurement;
 
     // calculate output
-    return error * kP + integral * kI + derivative * kD;
+    GainPoint gains {0, kP, kI, kD};
+    if (schedule.isEnabled()) gains = schedule.lookup(error);
+    const float output = error * gains.kP + integral * gains.kI + derivative * gains.kD + feedforward;
+    if (outputLimit <= 0 || fabs(output) <= outputLimit) return output;
+    // don't let the integral wind up while the output is limited
+    if (sgn(error) == sgn(output)) integral = std::min(fabs(prevIntegral), fabs(integral)) * sgn(integral);
+    return std::clamp(output, -outputLimit, outputLimit);
 }
 
 void PID::reset() {
     integral = 0;
     prevError = 0;
+    prevMeasurement = NAN;
+    derivative = 0;
+    prevTime = 0;
+}
+
+void PID::setDerivativeFilter(float timeConstant) { derivativeFilter = timeConstant; }
+
+void PID::setDerivativeOnMeasurement(bool enabled) { derivativeOnMeasurement = enabled; }
+
+void PID::setOutputLimit(float limit) { outputLimit = limit; }
+
+void PID::setGainSchedule(GainSchedule schedule) { this->schedule = schedule; }
+
+const GainSchedule& PID::getGainSchedule() const { return schedule; }
+
+void PID::setGains(float kP, float kI, float kD) {
+    this->kP = kP;
+    this->kI = kI;
+    this->kD = kD;
 }
-} // namespace lemlib
\ No newline at end of file
+} // namespace lemlib
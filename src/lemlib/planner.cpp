@@ -0,0 +1,401 @@
+#include <cmath>
+#include <algorithm>
+#include <queue>
+#include "lemlib/planner.hpp"
+#include "lemlib/logger/logger.hpp"
+
+namespace lemlib {
+OccupancyGrid::OccupancyGrid(float width, float height, float resolution)
+    : columns(std::max(1, int(std::ceil(width / resolution)))),
+      rows(std::max(1, int(std::ceil(height / resolution)))),
+      words((columns + 63) / 64),
+      resolution(resolution),
+      cells(rows * words, 0) {}
+
+void OccupancyGrid::setSpan(int row, int first, int last) {
+    if (row < 0 || row >= rows) return;
+    first = std::max(first, 0);
+    last = std::min(last, columns - 1);
+    // set whole words at once
+    for (int column = first; column <= last;) {
+        const int bit = column % 64;
+        const int count = std::min(64 - bit, last - column + 1);
+        const std::uint64_t mask = count == 64 ? ~std::uint64_t(0) : ((std::uint64_t(1) << count) - 1) << bit;
+        cells[row * words + column / 64] |= mask;
+        column += count;
+    }
+}
+
+void OccupancyGrid::addRectangle(float x1, float y1, float x2, float y2) {
+    int column1, row1, column2, row2;
+    toCell(std::min(x1, x2), std::min(y1, y2), column1, row1);
+    toCell(std::max(x1, x2), std::max(y1, y2), column2, row2);
+    for (int row = row1; row <= row2; row++) setSpan(row, column1, column2);
+}
+
+void OccupancyGrid::addCircle(float x, float y, float radius) {
+    int firstRow, lastRow, column;
+    toCell(x, y - radius, column, firstRow);
+    toCell(x, y + radius, column, lastRow);
+    for (int row = firstRow; row <= lastRow; row++) {
+        // half the width of the circle at the center of the row
+        float cellX, cellY;
+        toPoint(0, row, cellX, cellY);
+        const float dy = std::min(std::fabs(cellY - y), radius);
+        const float halfWidth = std::sqrt(radius * radius - dy * dy);
+        int first, last, unused;
+        toCell(x - halfWidth, cellY, first, unused);
+        toCell(x + halfWidth, cellY, last, unused);
+        setSpan(row, first, last);
+    }
+}
+
+void OccupancyGrid::clear() { std::fill(cells.begin(), cells.end(), 0); }
+
+bool OccupancyGrid::isOccupied(int column, int row) const {
+    if (column < 0 || column >= columns || row < 0 || row >= rows) return true;
+    return (cells[row * words + column / 64] >> (column % 64)) & 1;
+}
+
+bool OccupancyGrid::isOccupied(float x, float y) const {
+    int column, row;
+    toCell(x, y, column, row);
+    return isOccupied(column, row);
+}
+
+OccupancyGrid OccupancyGrid::inflate(float radius) const {
+    OccupancyGrid inflated = *this;
+    const int cellRadius = std::ceil(radius / resolution);
+    // half width of the disk in every row it covers
+    std::vector<int> spans(cellRadius + 1);
+    for (int dy = 0; dy <= cellRadius; dy++) {
+        spans[dy] = std::floor(std::sqrt(std::max(0.0f, radius * radius / (resolution * resolution) - dy * dy)));
+    }
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            if (!isOccupied(column, row)) continue;
+            for (int dy = -cellRadius; dy <= cellRadius; dy++) {
+                const int span = spans[std::abs(dy)];
+                inflated.setSpan(row + dy, column - span, column + span);
+            }
+        }
+    }
+    return inflated;
+}
+
+int OccupancyGrid::getColumns() const { return columns; }
+
+int OccupancyGrid::getRows() const { return rows; }
+
+float OccupancyGrid::getResolution() const { return resolution; }
+
+void OccupancyGrid::toCell(float x, float y, int& column, int& row) const {
+    column = std::floor(x / resolution + columns / 2.0f);
+    row = std::floor(y / resolution + rows / 2.0f);
+}
+
+void OccupancyGrid::toPoint(int column, int row, float& x, float& y) const {
+    x = (column + 0.5f - columns / 2.0f) * resolution;
+    y = (row + 0.5f - rows / 2.0f) * resolution;
+}
+
+/**
+ * @brief Check whether the robot can be in a cell, coming from a neighbouring cell
+ *
+ * The robot can drive out of the inflated area around the start, but never back in. So an inflated cell can only be
+ * entered from another inflated cell, and only if it isn't an obstacle
+ */
+bool traversable(const OccupancyGrid& obstacles, const OccupancyGrid& inflated, bool fromInflated, int column,
+                 int row) {
+    if (!inflated.isOccupied(column, row)) return true;
+    return fromInflated && !obstacles.isOccupied(column, row);
+}
+
+/**
+ * @brief Check whether the robot can step from a cell to one of its 8 neighbours, without cutting corners
+ */
+bool canStep(const OccupancyGrid& obstacles, const OccupancyGrid& inflated, int column, int row, int dx, int dy) {
+    const bool fromInflated = inflated.isOccupied(column, row);
+    if (!traversable(obstacles, inflated, fromInflated, column + dx, row + dy)) return false;
+    if (dx == 0 || dy == 0) return true;
+    return traversable(obstacles, inflated, fromInflated, column + dx, row) &&
+           traversable(obstacles, inflated, fromInflated, column, row + dy);
+}
+
+/**
+ * @brief Check whether the robot can drive in a straight line between the centers of two cells
+ *
+ * Like a step between neighbours, the line can leave the inflated area it starts in, but never enter it
+ */
+bool lineOfSight(const OccupancyGrid& obstacles, const OccupancyGrid& inflated, int column1, int row1, int column2,
+                 int row2) {
+    // step through every cell the line touches
+    const int dx = std::abs(column2 - column1);
+    const int dy = std::abs(row2 - row1);
+    const int stepX = column2 > column1 ? 1 : -1;
+    const int stepY = row2 > row1 ? 1 : -1;
+    int column = column1;
+    int row = row1;
+    int error = dx - dy;
+    // whether every cell so far has been inflated
+    bool escaping = inflated.isOccupied(column1, row1);
+    while (true) {
+        if (!traversable(obstacles, inflated, escaping, column, row)) return false;
+        escaping = escaping && inflated.isOccupied(column, row);
+        if (column == column2 && row == row2) return true;
+        if (error > 0) {
+            column += stepX;
+            error -= 2 * dy;
+        } else if (error < 0) {
+            row += stepY;
+            error += 2 * dx;
+        } else {
+            // the line passes exactly through a corner. It's only blocked if the cells on both sides are blocked
+            if (!traversable(obstacles, inflated, escaping, column + stepX, row) &&
+                !traversable(obstacles, inflated, escaping, column, row + stepY)) {
+                return false;
+            }
+            column += stepX;
+            row += stepY;
+            error += 2 * (dx - dy);
+        }
+    }
+}
+
+/**
+ * @brief Check whether the goal is sealed off from the start
+ *
+ * Theta* has to expand every cell the robot can reach before it knows that the goal can't be reached, which is its
+ * worst case. Usually the goal, or the robot, is in a small pocket. Flood filling from both sides at once finds this
+ * quickly, since the side in the pocket runs out of cells. The robot can't drive back into the inflated area once it
+ * leaves it, so the inflated area around the start is filled first, and only free cells are left, which can be
+ * filled from either side. The check gives up after a fixed number of cells, and leaves the rest to the search
+ *
+ * @return true if the goal is sealed off, false if it can be reached or the check gave up
+ */
+bool sealedOff(const OccupancyGrid& obstacles, const OccupancyGrid& inflated, int start, int goal) {
+    constexpr std::size_t MAX_CELLS = 1024;
+    if (start == goal) return false;
+    enum Side : std::uint8_t { NONE, START, GOAL };
+    const int columns = inflated.getColumns();
+    std::vector<std::uint8_t> visited(columns * inflated.getRows(), NONE);
+    std::vector<int> escape; // inflated cells around the start
+    std::vector<int> fromStart;
+    std::vector<int> fromGoal = {goal};
+    auto enqueue = [&](int cell, Side side) {
+        visited[cell] = side;
+        if (side == GOAL) fromGoal.push_back(cell);
+        else if (inflated.isOccupied(cell % columns, cell / columns)) escape.push_back(cell);
+        else fromStart.push_back(cell);
+    };
+    // visit the neighbours of a cell, and return whether one was already visited from the other side
+    auto expand = [&](int cell, Side side) {
+        const int column = cell % columns;
+        const int row = cell / columns;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0) continue;
+                // cells outside of the grid are occupied, so they're never traversable
+                if (!canStep(obstacles, inflated, column, row, dx, dy)) continue;
+                const int next = (row + dy) * columns + column + dx;
+                if (visited[next] == NONE) enqueue(next, side);
+                else if (visited[next] != side) return true;
+            }
+        }
+        return false;
+    };
+    auto tooMany = [&]() { return escape.size() + fromStart.size() + fromGoal.size() > MAX_CELLS; };
+
+    visited[goal] = GOAL;
+    enqueue(start, START);
+    for (std::size_t i = 0; i < escape.size(); i++) {
+        if (tooMany() || expand(escape[i], START)) return false;
+    }
+    std::size_t startIndex = 0;
+    std::size_t goalIndex = 0;
+    while (startIndex < fromStart.size() && goalIndex < fromGoal.size()) {
+        if (tooMany() || expand(fromStart[startIndex++], START) || expand(fromGoal[goalIndex++], GOAL)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Run Lazy Theta* on a grid
+ *
+ * Lazy Theta* assumes every cell can see the parent of the cell it was reached from, and only checks the line of sight
+ * when the cell is expanded. This needs one line of sight check per expanded cell instead of one per neighbour
+ *
+ * @param obstacles the obstacles at their actual size
+ * @param inflated the obstacles grown by the radius of the robot
+ * @param timeBudget longest time to search for, in microseconds
+ * @param cells the cells on the path, from the start to the goal
+ * @return PlanStatus whether a path was found
+ */
+PlanStatus thetaStar(const OccupancyGrid& obstacles, const OccupancyGrid& inflated, int startColumn, int startRow,
+                     int goalColumn, int goalRow, std::uint64_t timeBudget, std::vector<int>& cells) {
+    const std::uint64_t startTime = pros::micros();
+    const int columns = inflated.getColumns();
+    const int rows = inflated.getRows();
+    if (obstacles.isOccupied(startColumn, startRow) || inflated.isOccupied(goalColumn, goalRow)) {
+        return PlanStatus::NO_PATH;
+    }
+    const int start = startRow * columns + startColumn;
+    const int goal = goalRow * columns + goalColumn;
+    if (sealedOff(obstacles, inflated, start, goal)) return PlanStatus::NO_PATH;
+    auto distance = [&](int a, int b) {
+        return std::hypot(float(a % columns - b % columns), float(a / columns - b / columns));
+    };
+
+    std::vector<float> costs(columns * rows, INFINITY);
+    std::vector<int> parents(columns * rows, -1);
+    std::vector<bool> closed(columns * rows, false);
+    using Node = std::pair<float, int>;
+    std::vector<Node> storage;
+    storage.reserve(columns * rows);
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> open(std::greater<Node>(), std::move(storage));
+    costs[start] = 0;
+    parents[start] = start;
+    open.push({distance(start, goal), start});
+
+    int expanded = 0;
+    while (!open.empty()) {
+        const int current = open.top().second;
+        open.pop();
+        if (closed[current]) continue;
+        closed[current] = true;
+        // check the time every so often, since reading it isn't free
+        if (++expanded % 64 == 0 && pros::micros() - startTime > timeBudget) return PlanStatus::TIMED_OUT;
+
+        const int column = current % columns;
+        const int row = current / columns;
+        // if the parent can't be seen, go through the best neighbour that has been expanded instead
+        // the start is its own parent, so it doesn't need to be checked
+        if (current != start &&
+            !lineOfSight(obstacles, inflated, parents[current] % columns, parents[current] / columns, column, row)) {
+            costs[current] = INFINITY;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    const int neighbourColumn = column + dx;
+                    const int neighbourRow = row + dy;
+                    if (neighbourColumn < 0 || neighbourColumn >= columns || neighbourRow < 0 ||
+                        neighbourRow >= rows || (dx == 0 && dy == 0)) {
+                        continue;
+                    }
+                    const int neighbour = neighbourRow * columns + neighbourColumn;
+                    if (!closed[neighbour]) continue;
+                    const float cost = costs[neighbour] + distance(neighbour, current);
+                    if (cost < costs[current]) {
+                        costs[current] = cost;
+                        parents[current] = neighbour;
+                    }
+                }
+            }
+        }
+        if (current == goal) break;
+        const int parent = parents[current];
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0) continue;
+                // cells outside of the grid are occupied, so they're never traversable
+                if (!canStep(obstacles, inflated, column, row, dx, dy)) continue;
+                const int next = (row + dy) * columns + column + dx;
+                if (closed[next]) continue;
+                // assume the parent can be seen. This is checked when the cell is expanded
+                const float cost = costs[parent] + distance(parent, next);
+                if (cost < costs[next]) {
+                    costs[next] = cost;
+                    parents[next] = parent;
+                    open.push({cost + distance(next, goal), next});
+                }
+            }
+        }
+    }
+    if (!closed[goal]) return PlanStatus::NO_PATH;
+
+    // walk back from the goal
+    cells.clear();
+    for (int cell = goal; cell != start; cell = parents[cell]) cells.push_back(cell);
+    cells.push_back(start);
+    std::reverse(cells.begin(), cells.end());
+
+    // smooth the path by skipping every point that can be skipped
+    std::vector<int> smoothed = {cells.front()};
+    for (std::size_t i = 1; i < cells.size(); i++) {
+        const int from = smoothed.back();
+        const bool last = i + 1 == cells.size();
+        if (last || !lineOfSight(obstacles, inflated, from % columns, from / columns, cells[i + 1] % columns,
+                                 cells[i + 1] / columns)) {
+            smoothed.push_back(cells[i]);
+        }
+    }
+    cells = std::move(smoothed);
+    return PlanStatus::FOUND;
+}
+
+PathPlanner::PathPlanner(PlannerSettings settings)
+    : settings(settings) {}
+
+std::vector<Waypoint> PathPlanner::plan(const OccupancyGrid& grid, float x, float y, Waypoint goal) {
+    mutex.take();
+    status = PlanStatus::PLANNING;
+    path.clear();
+    mutex.give();
+
+    const std::uint64_t startTime = pros::micros();
+    const OccupancyGrid inflated = grid.inflate(settings.robotRadius);
+    int startColumn, startRow, goalColumn, goalRow;
+    grid.toCell(x, y, startColumn, startRow);
+    grid.toCell(goal.x, goal.y, goalColumn, goalRow);
+    std::vector<int> cells;
+    const std::uint64_t budget = std::uint64_t(std::max(settings.timeBudget, 0)) * 1000;
+    const std::uint64_t remaining = budget - std::min(budget, pros::micros() - startTime);
+    const PlanStatus result =
+        thetaStar(grid, inflated, startColumn, startRow, goalColumn, goalRow, remaining, cells);
+
+    // convert the cells to points. The start is left out, and the goal is kept exactly
+    std::vector<Waypoint> points;
+    if (result == PlanStatus::FOUND) {
+        for (std::size_t i = 1; i + 1 < cells.size(); i++) {
+            float pointX, pointY;
+            grid.toPoint(cells[i] % grid.getColumns(), cells[i] / grid.getColumns(), pointX, pointY);
+            points.push_back({pointX, pointY});
+        }
+        points.push_back(goal);
+    }
+    if (result == PlanStatus::TIMED_OUT) infoSink()->warn("PathPlanner: ran out of time");
+    else if (result == PlanStatus::NO_PATH) infoSink()->warn("PathPlanner: no path to ({}, {})", goal.x, goal.y);
+    infoSink()->debug("PathPlanner: planned {} points in {}us", points.size(), pros::micros() - startTime);
+
+    mutex.take();
+    status = result;
+    path = points;
+    mutex.give();
+    return points;
+}
+
+void PathPlanner::planAsync(const OccupancyGrid& grid, float x, float y, Waypoint goal) {
+    waitUntilDone();
+    mutex.take();
+    status = PlanStatus::PLANNING;
+    mutex.give();
+    pros::Task task([this, grid, x, y, goal]() { plan(grid, x, y, goal); });
+}
+
+PlanStatus PathPlanner::getStatus() {
+    mutex.take();
+    const PlanStatus result = status;
+    mutex.give();
+    return result;
+}
+
+std::vector<Waypoint> PathPlanner::getPath() {
+    mutex.take();
+    const std::vector<Waypoint> result = path;
+    mutex.give();
+    return result;
+}
+
+void PathPlanner::waitUntilDone() {
+    while (getStatus() == PlanStatus::PLANNING) pros::delay(10);
+}
+} // namespace lemlib